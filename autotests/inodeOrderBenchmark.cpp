@@ -0,0 +1,131 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "Config.h"
+#include "testTree.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <unistd.h>
+
+using namespace Filelight;
+
+/**
+ * Times scans listing folders in readdir() order against scans listing them
+ * sorted by inode number, see Config::inodeOrder. The order only matters
+ * while the inodes come from the disk, so the caches are dropped before
+ * every scan when the benchmark may, which takes root. Otherwise warm scans
+ * are timed, which shows what the sorting costs.
+ *
+ * The tree is generated in the temporary folder, FILELIGHT_BENCHMARK_DIR
+ * names a folder to scan instead, on the disk to measure.
+ */
+class InodeOrderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void order_data();
+    void order();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_path;
+    uint m_entries;
+    bool m_dropCaches;
+};
+
+/// The generated tree, see makeTestTree(). Big folders, the sort is per folder.
+static const int Folders = 32;
+static const int Files = 128;
+
+static bool
+dropCaches()
+{
+    sync();
+    QFile file(QStringLiteral("/proc/sys/vm/drop_caches"));
+    return file.open(QIODevice::WriteOnly) && file.write("3") == 1;
+}
+
+void
+InodeOrderBenchmark::initTestCase()
+{
+    setTestConfig();
+
+    m_path = QFile::decodeName(qgetenv("FILELIGHT_BENCHMARK_DIR"));
+    if (!m_path.isEmpty()) {
+        if (!m_path.endsWith(QLatin1Char('/'))) {
+            m_path += QLatin1Char('/');
+        }
+        m_entries = 0;
+    } else {
+        QVERIFY(m_dir.isValid());
+        m_path = m_dir.path() + QLatin1Char('/');
+        m_entries = makeTestTree(m_path, Folders, Files);
+        QVERIFY(m_entries);
+    }
+
+    m_dropCaches = dropCaches();
+    if (!m_dropCaches) {
+        qWarning() << "Cannot drop the caches, timing scans of cached inodes";
+    }
+}
+
+void
+InodeOrderBenchmark::order_data()
+{
+    QTest::addColumn<int>("inodeOrder");
+
+    QTest::newRow("readdir") << int(Config::InodeOrderNever);
+    QTest::newRow("inode") << int(Config::InodeOrderAlways);
+}
+
+void
+InodeOrderBenchmark::order()
+{
+    QFETCH(int, inodeOrder);
+    Config::inodeOrder = Config::InodeOrder(inodeOrder);
+
+    Folder *tree = nullptr;
+    if (m_dropCaches) {
+        QVERIFY(dropCaches());
+        QBENCHMARK_ONCE {
+            tree = scanTestTree(m_path);
+        }
+    } else {
+        QBENCHMARK {
+            Folder::deleteTree(tree);
+            tree = scanTestTree(m_path);
+        }
+    }
+
+    QVERIFY(tree);
+    if (m_entries) {
+        QCOMPARE(tree->children(), m_entries);
+    }
+    Folder::deleteTree(tree);
+}
+
+QTEST_GUILESS_MAIN(InodeOrderBenchmark)
+
+#include "inodeOrderBenchmark.moc"
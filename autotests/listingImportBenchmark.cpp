@@ -0,0 +1,92 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "Config.h"
+#include "fileTree.h"
+#include "listingImport.h"
+#include "scanContext.h"
+#include "testListing.h"
+
+#include <QTemporaryFile>
+#include <QTest>
+
+using namespace Filelight;
+
+/**
+ * Times reading a du -a listing of about 75 MB, in one part and in parts
+ * read by as many threads as there are cores.
+ */
+class ListingImportBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void readLines_data();
+    void readLines();
+
+private:
+    QTemporaryFile m_file;
+};
+
+void
+ListingImportBenchmark::initTestCase()
+{
+    QByteArray listing;
+    QRandomGenerator random(7);
+    writeTestListing(&listing, DuAll, '\n', &random, "/srv/data", 16000, 6);
+
+    QVERIFY(m_file.open());
+    QCOMPARE(m_file.write(listing), qint64(listing.size()));
+    QVERIFY(m_file.flush());
+}
+
+void
+ListingImportBenchmark::readLines_data()
+{
+    QTest::addColumn<uint>("threads");
+
+    QTest::addRow("1 thread") << 1u;
+    QTest::addRow("%d threads", QThread::idealThreadCount()) << uint(QThread::idealThreadCount());
+}
+
+void
+ListingImportBenchmark::readLines()
+{
+    QFETCH(uint, threads);
+    Config::scanThreads = threads;
+
+    QBENCHMARK {
+        ScanContext context;
+        Folder *tree = nullptr;
+        ListingImport import(m_file.fileName(), &context);
+        connect(&import, &ListingImport::branchCompleted, [&tree](Folder *completed) {
+            tree = completed;
+        });
+        import.start();
+        import.wait();
+        QVERIFY(tree);
+        Folder::deleteTree(tree);
+    }
+}
+
+QTEST_GUILESS_MAIN(ListingImportBenchmark)
+
+#include "listingImportBenchmark.moc"
@@ -0,0 +1,148 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "Config.h"
+#include "fileTree.h"
+#include "listingImport.h"
+#include "scanContext.h"
+#include "testListing.h"
+
+#include <QTemporaryFile>
+#include <QTest>
+
+#include <algorithm>
+
+using namespace Filelight;
+
+/**
+ * Reads the same listings in one part and in many and checks the trees are
+ * the same. Parts after the first start inside folders the parts before
+ * them opened, as ghosts that joining the parts resolves, and du's totals
+ * of folders may be the first line of a part.
+ */
+class ListingImportTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void parts_data();
+    void parts();
+};
+
+static Folder*
+import(const QString &fileName, uint parts)
+{
+    //a part for every thread, however small the listing
+    Config::scanThreads = parts;
+    ScanContext context;
+    Folder *tree = nullptr;
+    ListingImport import(fileName, &context);
+    import.setPartSize(1);
+    QObject::connect(&import, &ListingImport::branchCompleted, [&tree](Folder *completed) {
+        tree = completed;
+    });
+    import.start();
+    import.wait();
+    return tree;
+}
+
+/// @return the path of the first entry below @p path where the trees differ, or an empty string
+static QByteArray
+difference(const Folder *a, const Folder *b, const QByteArray &path)
+{
+    if (a->size() != b->size() || a->children() != b->children() || a->files.size() != b->files.size()) {
+        return path;
+    }
+
+    auto byName = [](const File *x, const File *y) {
+        return qstrcmp(x->name8Bit(), y->name8Bit()) < 0;
+    };
+    QList<File*> as = a->files;
+    QList<File*> bs = b->files;
+    std::sort(as.begin(), as.end(), byName);
+    std::sort(bs.begin(), bs.end(), byName);
+
+    for (int i = 0; i < as.size(); ++i) {
+        const QByteArray name = path + as[i]->name8Bit();
+        if (qstrcmp(as[i]->name8Bit(), bs[i]->name8Bit()) != 0 || as[i]->isFolder() != bs[i]->isFolder()
+                || as[i]->size() != bs[i]->size()) {
+            return name;
+        }
+        if (as[i]->isFolder()) {
+            const QByteArray inner = difference(static_cast<const Folder*>(as[i]), static_cast<const Folder*>(bs[i]), name);
+            if (!inner.isEmpty()) {
+                return inner;
+            }
+        }
+    }
+    return QByteArray();
+}
+
+void
+ListingImportTest::parts_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<char>("terminator");
+    QTest::addColumn<uint>("parts");
+
+    for (const uint parts : { 2u, 3u, 7u, 16u, 64u }) {
+        QTest::addRow("du -a, %u parts", parts) << int(DuAll) << '\n' << parts;
+        QTest::addRow("du -a -0, %u parts", parts) << int(DuAll) << '\0' << parts;
+        QTest::addRow("du, %u parts", parts) << int(DuFolders) << '\n' << parts;
+        QTest::addRow("find, %u parts", parts) << int(Find) << '\n' << parts;
+    }
+}
+
+void
+ListingImportTest::parts()
+{
+    QFETCH(int, format);
+    QFETCH(char, terminator);
+    QFETCH(uint, parts);
+
+    QByteArray listing;
+    QRandomGenerator random(7);
+    const FileSize bytes = writeTestListing(&listing, ListingFormat(format), terminator, &random, "/srv/data", 12, 6);
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(listing), qint64(listing.size()));
+    QVERIFY(file.flush());
+
+    Folder *whole = import(file.fileName(), 1);
+    Folder *cut = import(file.fileName(), parts);
+    QVERIFY(whole);
+    QVERIFY(cut);
+
+    QCOMPARE(whole->name8Bit(), cut->name8Bit());
+    if (format == DuAll) {
+        //find's empty folders show as files of a block, du -a's as empty ones
+        QCOMPARE(whole->size(), bytes);
+    }
+    const QByteArray path = difference(whole, cut, whole->name8Bit());
+    QVERIFY2(path.isEmpty(), path.constData());
+
+    Folder::deleteTree(whole);
+    Folder::deleteTree(cut);
+}
+
+QTEST_GUILESS_MAIN(ListingImportTest)
+
+#include "listingImportTest.moc"
@@ -0,0 +1,138 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "Config.h"
+#include "testTree.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Filelight;
+
+/**
+ * Times scans of a generated tree, or of the folder FILELIGHT_BENCHMARK_DIR
+ * names. The tree is in the page cache after the first run, so this times
+ * what the scan does with the entries rather than the disk.
+ */
+class ScanBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void threads_data();
+    void threads();
+    void stat_data();
+    void stat();
+
+private:
+    void benchmarkScan();
+
+    QTemporaryDir m_dir;
+    QString m_path;
+    uint m_entries;
+};
+
+/// The generated tree, see makeTestTree().
+static const int Folders = 64;
+static const int Files = 16;
+
+void
+ScanBenchmark::initTestCase()
+{
+    setTestConfig();
+
+    m_path = QFile::decodeName(qgetenv("FILELIGHT_BENCHMARK_DIR"));
+    if (!m_path.isEmpty()) {
+        if (!m_path.endsWith(QLatin1Char('/'))) {
+            m_path += QLatin1Char('/');
+        }
+        m_entries = 0;
+        return;
+    }
+
+    QVERIFY(m_dir.isValid());
+    m_path = m_dir.path() + QLatin1Char('/');
+    m_entries = makeTestTree(m_path, Folders, Files);
+    QVERIFY(m_entries);
+}
+
+void
+ScanBenchmark::threads_data()
+{
+    QTest::addColumn<uint>("threads");
+
+    const uint ideal = uint(QThread::idealThreadCount());
+    for (uint threads = 1; threads < ideal; threads *= 2) {
+        QTest::addRow("%u", threads) << threads;
+    }
+    QTest::addRow("%u", ideal) << ideal;
+}
+
+void
+ScanBenchmark::benchmarkScan()
+{
+    QBENCHMARK {
+        Folder *tree = scanTestTree(m_path);
+        QVERIFY(tree);
+        if (m_entries) {
+            QCOMPARE(tree->children(), m_entries);
+        }
+        Folder::deleteTree(tree);
+    }
+}
+
+void
+ScanBenchmark::threads()
+{
+    QFETCH(uint, threads);
+    Config::scanThreads = threads;
+    benchmarkScan();
+}
+
+void
+ScanBenchmark::stat_data()
+{
+    QTest::addColumn<bool>("useStatx");
+    QTest::addColumn<uint>("threads");
+
+    //statx() fetches less, which matters most where a single thread waits on every call
+    const uint ideal = uint(QThread::idealThreadCount());
+    QTest::addRow("fstatat, 1 thread") << false << 1u;
+    QTest::addRow("statx, 1 thread") << true << 1u;
+    QTest::addRow("fstatat, %u threads", ideal) << false << ideal;
+    QTest::addRow("statx, %u threads", ideal) << true << ideal;
+}
+
+void
+ScanBenchmark::stat()
+{
+    QFETCH(bool, useStatx);
+    QFETCH(uint, threads);
+    Config::useStatx = useStatx;
+    Config::scanThreads = threads;
+    benchmarkScan();
+    Config::useStatx = true;
+}
+
+QTEST_GUILESS_MAIN(ScanBenchmark)
+
+#include "scanBenchmark.moc"
@@ -0,0 +1,72 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef TESTLISTING_H
+#define TESTLISTING_H
+
+#include "fileTree.h"
+
+#include <QByteArray>
+#include <QRandomGenerator>
+
+/// What the generated listings look like.
+enum ListingFormat {
+    DuAll, // du -a -B1, folders after their contents with their totals
+    DuFolders, // du -B1, just the folders
+    Find // find -printf '%s %p\n', folders before their contents
+};
+
+/**
+ * Appends a listing of a generated tree below @p path to @p out, the same
+ * tree for generators seeded the same. The folder @p path has @p folders
+ * subfolders, those below up to three, down to @p depth levels.
+ * @return the bytes of its files
+ */
+inline FileSize
+writeTestListing(QByteArray *out, ListingFormat format, char terminator, QRandomGenerator *random,
+                 const QByteArray &path, int folders, int depth)
+{
+    if (format == Find) {
+        *out += "4096 " + path + terminator;
+    }
+
+    FileSize total = 0;
+    const int files = random->bounded(12);
+    for (int i = 0; i < files; ++i) {
+        const FileSize size = FileSize(random->bounded(1, 100000));
+        total += size;
+        if (format != DuFolders) {
+            *out += QByteArray::number(size) + (format == Find ? ' ' : '\t') + path + "/f" + QByteArray::number(i) + terminator;
+        }
+    }
+    if (depth > 0) {
+        for (int i = 0; i < folders; ++i) {
+            total += writeTestListing(out, format, terminator, random, path + "/d" + QByteArray::number(i),
+                                      random->bounded(4), depth - 1);
+        }
+    }
+
+    if (format != Find) {
+        *out += QByteArray::number(total) + '\t' + path + terminator;
+    }
+    return total;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef TESTTREE_H
+#define TESTTREE_H
+
+#include "Config.h"
+#include "fileTree.h"
+#include "localLister.h"
+#include "scanContext.h"
+
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+/// An exact scan that leaves nothing on disk, like filelight-scan's, that
+/// stats with statx() and lists folders in readdir() order.
+inline void
+setTestConfig()
+{
+    using Filelight::Config;
+    Config::scanAcrossMounts = false;
+    Config::countHardlinksOnce = true;
+    Config::useStatx = true;
+    Config::ioUringScan = Config::IoUringNever;
+    Config::inodeOrder = Config::InodeOrderNever;
+    Config::scanThreads = 0;
+    Config::scanTimeBudget = 0;
+    Config::sampleProbes = 0;
+    Config::scanSnapshots = false;
+    Config::checkpointInterval = 0;
+}
+
+/// Fills the folder @p path, with a trailing slash, with @p folders folders
+/// holding as many subfolders each, and @p files files of 100 bytes in every
+/// subfolder. @return the entries made, 0 if one could not be
+inline uint
+makeTestTree(const QString &path, int folders, int files)
+{
+    const QByteArray content(100, 'x');
+    for (int i = 0; i < folders; ++i) {
+        for (int j = 0; j < folders; ++j) {
+            const QString folder = path + QStringLiteral("%1/%2/").arg(i).arg(j);
+            if (!QDir().mkpath(folder)) {
+                return 0;
+            }
+            for (int k = 0; k < files; ++k) {
+                QFile file(folder + QString::number(k));
+                if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return uint(folders + folders * folders * (1 + files));
+}
+
+/// Scans @p path the way filelight-scan does, with the settings in Config.
+inline Folder*
+scanTestTree(const QString &path)
+{
+    Filelight::ScanContext context;
+    Folder *tree = nullptr;
+    Filelight::LocalLister lister(path, new QHash<QByteArray, Folder*>, &context);
+    QObject::connect(&lister, &Filelight::LocalLister::branchCompleted, [&tree](Folder *completed) {
+        tree = completed;
+    });
+    lister.start();
+    lister.wait();
+    return tree;
+}
+
+#endif
@@ -25,18 +25,31 @@
 #include <KConfigGroup>
 #include <KSharedConfig>
 
+#ifndef FILELIGHT_HEADLESS
 #include <QFont>
+#endif
 
 bool Config::scanAcrossMounts;
 bool Config::scanRemoteMounts;
 bool Config::scanRemovableMedia;
+bool Config::countHardlinksOnce;
+bool Config::apparentSizes;
 bool Config::varyLabelFontSizes;
 bool Config::showSmallFiles;
+bool Config::useStatx;
 bool Config::antialias;
 uint Config::contrast;
 int Config::minFontPitch;
 uint Config::defaultRingDepth;
+uint Config::scanThreads;
+uint Config::scanTimeBudget;
+uint Config::sampleProbes;
+uint Config::watchFolders;
+bool Config::scanSnapshots;
+uint Config::checkpointInterval;
 Filelight::MapScheme Config::scheme;
+Config::IoUringScan Config::ioUringScan;
+Config::InodeOrder Config::inodeOrder;
 QStringList Config::skipList;
 
 void
@@ -47,13 +60,28 @@ Filelight::Config::read()
     scanAcrossMounts   = config.readEntry("scanAcrossMounts", false);
     scanRemoteMounts   = config.readEntry("scanRemoteMounts", false);
     scanRemovableMedia = config.readEntry("scanRemovableMedia", false);
+    countHardlinksOnce = config.readEntry("countHardlinksOnce", false);
+    apparentSizes      = config.readEntry("apparentSizes", false);
     varyLabelFontSizes = config.readEntry("varyLabelFontSizes", true);
     showSmallFiles     = config.readEntry("showSmallFiles", false);
     contrast           = config.readEntry("contrast", 75);
     antialias          = config.readEntry("antialias", true);
+#ifdef FILELIGHT_HEADLESS
+    minFontPitch       = config.readEntry("minFontPitch", 0); //filelight-scan draws no labels
+#else
     minFontPitch       = config.readEntry("minFontPitch", QFont().pointSize() - 3);
+#endif
     scheme = (MapScheme) config.readEntry("scheme", 0);
     skipList           = config.readEntry("skipList", QStringList());
+    scanThreads        = config.readEntry("scanThreads", 0);
+    useStatx           = config.readEntry("useStatx", true);
+    ioUringScan        = (IoUringScan) config.readEntry("ioUringScan", (int)IoUringRemote);
+    inodeOrder         = (InodeOrder) config.readEntry("inodeOrder", (int)InodeOrderRotational);
+    scanTimeBudget     = config.readEntry("scanTimeBudget", 0);
+    sampleProbes       = config.readEntry("sampleProbes", 0);
+    watchFolders       = config.readEntry("watchFolders", 0);
+    scanSnapshots      = config.readEntry("scanSnapshots", false);
+    checkpointInterval = config.readEntry("checkpointInterval", 0);
 
     defaultRingDepth   = 4;
 }
@@ -66,6 +94,8 @@ Filelight::Config::write()
     config.writeEntry("scanAcrossMounts", scanAcrossMounts);
     config.writeEntry("scanRemoteMounts", scanRemoteMounts);
     config.writeEntry("scanRemovableMedia", scanRemovableMedia);
+    config.writeEntry("countHardlinksOnce", countHardlinksOnce);
+    config.writeEntry("apparentSizes", apparentSizes);
     config.writeEntry("varyLabelFontSizes", varyLabelFontSizes);
     config.writeEntry("showSmallFiles", showSmallFiles);
     config.writeEntry("contrast", contrast);
@@ -74,4 +104,13 @@ Filelight::Config::write()
     config.writeEntry("scheme", (int)scheme); // TODO: make the enum belong to a qwidget,
     //and use magic macros to make it save this properly
     config.writePathEntry("skipList", skipList);
+    config.writeEntry("scanThreads", scanThreads);
+    config.writeEntry("useStatx", useStatx);
+    config.writeEntry("ioUringScan", (int)ioUringScan);
+    config.writeEntry("inodeOrder", (int)inodeOrder);
+    config.writeEntry("scanTimeBudget", scanTimeBudget);
+    config.writeEntry("sampleProbes", sampleProbes);
+    config.writeEntry("watchFolders", watchFolders);
+    config.writeEntry("scanSnapshots", scanSnapshots);
+    config.writeEntry("checkpointInterval", checkpointInterval);
 }
@@ -28,7 +28,7 @@ class KConfig;
 
 namespace Filelight
 {
-enum MapScheme { Rainbow, KDE, HighContrast, FileDensity, ModTime };
+enum MapScheme { Rainbow, KDE, HighContrast, FileDensity, ModTime, SparseFiles };
 
 class Config
 {
@@ -43,12 +43,25 @@ public:
     static bool scanAcrossMounts;
     static bool scanRemoteMounts;
     static bool scanRemovableMedia;
+    static bool countHardlinksOnce;
+    static bool apparentSizes; ///map the sizes files claim rather than the space they take
     static bool varyLabelFontSizes;
     static bool showSmallFiles;
     static uint contrast;
     static bool antialias;
     static int minFontPitch;
     static uint defaultRingDepth;
+    static uint scanThreads; ///0 picks one worker per core
+    static bool useStatx;
+    enum IoUringScan { IoUringNever, IoUringRemote, IoUringAlways };
+    static IoUringScan ioUringScan; ///when files are stat'ed in io_uring batches
+    enum InodeOrder { InodeOrderNever, InodeOrderRotational, InodeOrderAlways };
+    static InodeOrder inodeOrder; ///when folders are listed sorted by inode number
+    static uint scanTimeBudget; ///seconds after which the folders not yet listed are estimated, 0 for no limit
+    static uint sampleProbes; ///random descents per subfolder when sizes are estimated instead of scanned, 0 to scan
+    static uint watchFolders; ///folders of the map kept up to date as files change, 0 to not follow changes
+    static bool scanSnapshots; ///completed scans are kept on disk and shown again until rescanned
+    static uint checkpointInterval; ///seconds between writes of a running scan's progress, 0 to not keep it
 
     static MapScheme scheme;
     static QStringList skipList;
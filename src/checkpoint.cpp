@@ -0,0 +1,413 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "checkpoint.h"
+
+#include "Config.h"
+#include "fileTree.h"
+#include "nodeArena.h"
+#include "snapshot.h"
+#include "filelight_debug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <string.h>
+
+namespace Filelight
+{
+
+static const char Magic[8] = { 'F', 'L', 'C', 'K', 'P', 'T', '\r', '\n' };
+static const quint32 Version = 1;
+static const int BufferSize = 1 << 20;
+
+enum Record : char { Started = 'S', Completed = 'C' };
+
+static QString
+fileName(const QByteArray &root)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/checkpoints/")
+           + QString::fromLatin1(QCryptographicHash::hash(root, QCryptographicHash::Sha1).toHex())
+           + QLatin1String(".journal");
+}
+
+template<typename T> static void
+put(QByteArray &buffer, T value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void
+putName(QByteArray &buffer, const char *name)
+{
+    const quint32 length = qstrlen(name);
+    put(buffer, length);
+    buffer.append(name, length);
+}
+
+/// Copies @p folder and all it holds, to be made of @p arena.
+static Folder*
+copyTree(const Folder *folder, NodeArena *arena)
+{
+    Folder *copy = arena->newFolder(folder->name8Bit());
+    copy->setChangeTime(folder->changeTime());
+    copy->copyTree(arena, folder);
+    if (folder->isEstimated()) {
+        copy->setEstimated();
+        copy->setEstimate(folder->allocatedSize(), folder->apparentSize(), folder->children(), folder->estimateMargin());
+    }
+    return copy;
+}
+
+/// Reads a journal, which may end in the middle of a record.
+struct JournalReader
+{
+    const uchar *data;
+    qint64 size;
+    qint64 pos;
+
+    template<typename T> bool get(T *value) {
+        if (size - pos < qint64(sizeof(T))) {
+            return false;
+        }
+        memcpy(value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool getName(QByteArray *name) {
+        quint32 length;
+        if (!get(&length) || size - pos < length) {
+            return false;
+        }
+        *name = QByteArray(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return !name->isEmpty();
+    }
+
+    /// The header, @return when the scan started or an invalid date
+    QDateTime header(const QByteArray &root) {
+        char magic[sizeof(Magic)];
+        quint32 version, settings;
+        qint64 started;
+        QByteArray name;
+        if (!get(&magic) || memcmp(magic, Magic, sizeof(Magic)) != 0 || !get(&version) || version != Version ||
+                !get(&settings) || settings != Snapshot::settingsHash() || !get(&started) || !getName(&name) || name != root) {
+            return QDateTime();
+        }
+        return QDateTime::fromMSecsSinceEpoch(started);
+    }
+};
+
+Checkpoint::Checkpoint(const QByteArray &root)
+        : m_root(root)
+        , m_interval(Config::checkpointInterval * 1000ul)
+        , m_file(fileName(root))
+        , m_stopping(false)
+        , m_keep(true)
+        , m_nextId(1)
+{
+}
+
+Checkpoint::~Checkpoint()
+{
+    wait();
+}
+
+void
+Checkpoint::started(const Folder *folder, const Folder *parent)
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.append({ folder, parent, false });
+}
+
+void
+Checkpoint::completed(const Folder *folder)
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.append({ folder, nullptr, true });
+}
+
+void
+Checkpoint::stop(bool keep)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_keep = keep;
+        m_wake.wakeAll();
+    }
+    wait();
+}
+
+void
+Checkpoint::run()
+{
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCDebug(FILELIGHT_LOG) << "Cannot write checkpoints to" << m_file.fileName() << m_file.errorString();
+    }
+
+    m_buffer.append(Magic, sizeof(Magic));
+    put(m_buffer, Version);
+    put(m_buffer, Snapshot::settingsHash());
+    put(m_buffer, QDateTime::currentMSecsSinceEpoch());
+    putName(m_buffer, m_root.constData());
+
+    QMutexLocker locker(&m_mutex);
+    for (;;) {
+        if (!m_stopping) {
+            m_wake.wait(&m_mutex, m_interval);
+        }
+        if (m_stopping && !m_keep) {
+            break;
+        }
+
+        //written outside the lock, the scan keeps queueing meanwhile
+        QVector<Event> events;
+        events.swap(m_events);
+        const bool stopping = m_stopping;
+        locker.unlock();
+        write(events);
+        locker.relock();
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    m_file.close();
+    if (!m_keep) {
+        m_file.remove();
+    }
+}
+
+void
+Checkpoint::write(const QVector<Event> &events)
+{
+    for (const Event &event : events) {
+        if (event.completed) {
+            writeCompleted(event.folder, m_ids.value(event.folder));
+        } else {
+            m_ids.insert(event.folder, writeStarted(event.folder, event.parent ? m_ids.value(event.parent) : 0));
+        }
+        if (m_buffer.size() > BufferSize) {
+            flush();
+        }
+    }
+    flush();
+}
+
+void
+Checkpoint::flush()
+{
+    if (m_file.isOpen()) {
+        m_file.write(m_buffer.constData(), m_buffer.size());
+        m_file.flush();
+    }
+    m_buffer.clear();
+}
+
+quint32
+Checkpoint::writeStarted(const Folder *folder, quint32 parent)
+{
+    const quint32 id = m_nextId++;
+    m_buffer.append(char(Started));
+    put(m_buffer, id);
+    put(m_buffer, parent);
+    putName(m_buffer, folder->name8Bit());
+    return id;
+}
+
+void
+Checkpoint::writeCompleted(const Folder *folder, quint32 id)
+{
+    //subfolders the scan did not report were grafted from a cached tree
+    QVector<const File*> files;
+    for (const File *file : folder->files) {
+        if (!file->isFolder()) {
+            files.append(file);
+        } else if (!m_ids.remove(static_cast<const Folder*>(file))) {
+            const Folder *grafted = static_cast<const Folder*>(file);
+            writeCompleted(grafted, writeStarted(grafted, id));
+        }
+    }
+
+    m_buffer.append(char(Completed));
+    put(m_buffer, id);
+    put(m_buffer, folder->changeTime());
+    put(m_buffer, quint8(folder->isEstimated()));
+    if (folder->isEstimated()) {
+        put(m_buffer, folder->allocatedSize());
+        put(m_buffer, folder->apparentSize());
+        put(m_buffer, quint32(folder->children()));
+        put(m_buffer, quint32(folder->estimateMargin()));
+    }
+    put(m_buffer, quint32(files.size()));
+    for (const File *file : qAsConst(files)) {
+        putName(m_buffer, file->name8Bit());
+        put(m_buffer, file->allocatedSize());
+        put(m_buffer, file->apparentSize());
+    }
+}
+
+QDateTime
+Checkpoint::find(const QByteArray &root)
+{
+    QFile file(fileName(root));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QDateTime();
+    }
+    const QByteArray header = file.read(sizeof(Magic) + 2 * sizeof(quint32) + sizeof(qint64) + sizeof(quint32) + root.size());
+    JournalReader reader = { reinterpret_cast<const uchar*>(header.constData()), header.size(), 0 };
+    return reader.header(root);
+}
+
+QHash<QByteArray, Folder*>
+Checkpoint::load(const QByteArray &root)
+{
+    QHash<QByteArray, Folder*> trees;
+    QFile file(fileName(root));
+    uchar *map = file.open(QIODevice::ReadOnly) ? file.map(0, file.size()) : nullptr;
+    if (!map) {
+        return trees;
+    }
+    JournalReader reader = { map, file.size(), 0 };
+    if (!reader.header(root).isValid()) {
+        file.unmap(map);
+        return trees;
+    }
+
+    struct Entry {
+        quint32 parent;
+        QByteArray name;
+        bool completed;
+        QVector<Folder*> folders; // the subfolders completed
+    };
+    QHash<quint32, Entry> entries;
+    Folder *tree = nullptr;
+    NodeArena *arena = new NodeArena;
+
+    //replayed up to the first record cut short
+    char type;
+    while (reader.get(&type)) {
+        quint32 id;
+        if (!reader.get(&id)) {
+            break;
+        }
+
+        if (type == Started) {
+            Entry entry = { 0, QByteArray(), false, {} };
+            if (!reader.get(&entry.parent) || !reader.getName(&entry.name) ||
+                    entries.contains(id) || (entry.parent && !entries.contains(entry.parent))) {
+                break;
+            }
+            entries.insert(id, entry);
+            continue;
+        }
+
+        auto it = entries.find(id);
+        qint64 changeTime;
+        quint8 estimated;
+        quint32 count;
+        if (type != Completed || it == entries.end() || it->completed || !reader.get(&changeTime) || !reader.get(&estimated)) {
+            break;
+        }
+        FileSize size = 0, apparentSize = 0;
+        quint32 children = 0, margin = 0;
+        if (estimated && (!reader.get(&size) || !reader.get(&apparentSize) || !reader.get(&children) || !reader.get(&margin))) {
+            break;
+        }
+        if (!reader.get(&count)) {
+            break;
+        }
+
+        Folder *folder = arena->newFolder(it->name.constData());
+        folder->setChangeTime(changeTime);
+        bool complete = true;
+        for (quint32 i = 0; i < count && complete; ++i) {
+            QByteArray name;
+            complete = reader.getName(&name) && reader.get(&size) && reader.get(&apparentSize);
+            if (complete) {
+                folder->append(arena, name.constData(), size, apparentSize);
+            }
+        }
+        if (!complete) {
+            //what completed below it is still of use
+            break;
+        }
+        for (Folder *subfolder : qAsConst(it->folders)) {
+            folder->append(subfolder);
+        }
+        if (estimated) {
+            folder->setEstimated();
+            folder->setEstimate(size, apparentSize, children, margin);
+        }
+        std::sort(folder->files.begin(), folder->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+
+        it->completed = true;
+        it->folders.clear();
+        if (it->parent) {
+            entries.find(it->parent)->folders.append(folder);
+        } else {
+            tree = folder;
+        }
+    }
+    file.unmap(map);
+
+    if (tree) {
+        tree->setArena(arena);
+        trees.insert(root, tree);
+        return trees;
+    }
+
+    //what completed below the folders still being listed
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (it->completed || it->folders.isEmpty()) {
+            continue;
+        }
+        QByteArray path;
+        for (const Entry *entry = &it.value(); entry; entry = entry->parent ? &*entries.constFind(entry->parent) : nullptr) {
+            path.prepend(entry->name);
+        }
+        //every one is a tree of its own, with an arena of its own
+        for (Folder *folder : it->folders) {
+            NodeArena *treeArena = new NodeArena;
+            Folder *copy = copyTree(folder, treeArena);
+            copy->setArena(treeArena);
+            trees.insert(path + folder->name8Bit(), copy);
+        }
+    }
+    delete arena;
+
+    qCDebug(FILELIGHT_LOG) << "Checkpoint of" << root << "holds" << trees.size() << "completed subtrees";
+    return trees;
+}
+
+void
+Checkpoint::remove(const QByteArray &root)
+{
+    QFile::remove(fileName(root));
+}
+
+}
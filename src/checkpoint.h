@@ -0,0 +1,107 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+class Folder;
+
+namespace Filelight
+{
+
+/**
+ * Keeps the progress of a running scan on disk, so it can be continued after
+ * a crash or the end of the session.
+ *
+ * The scan reports every folder it starts listing and every folder it
+ * completes. Those are queued and written to a journal by this thread once
+ * every Config::checkpointInterval seconds, each folder once, so the work
+ * left to the scanning threads is appending a pointer to a queue. Reading
+ * the journal back yields the subtrees completed, the scan continued with
+ * them grafted in only lists the folders around them again.
+ */
+class Checkpoint : public QThread
+{
+public:
+    /// Starts a journal for the scan of @p root, replacing an older one.
+    explicit Checkpoint(const QByteArray &root);
+    ~Checkpoint() override;
+
+    /// @p folder is about to be listed, @p parent is 0 for the scan's root.
+    void started(const Folder *folder, const Folder *parent);
+
+    /// @p folder and everything below it are complete, its subfolders
+    /// have all been reported completed before.
+    void completed(const Folder *folder);
+
+    /// Writes what is queued and stops, removing the journal unless @p keep.
+    void stop(bool keep);
+
+    /// When the journal left by an interrupted scan of @p root was started,
+    /// invalid if there is none or it was taken with other settings.
+    static QDateTime find(const QByteArray &root);
+
+    /// The subtrees completed by the interrupted scan of @p root, by full
+    /// path. Holds @p root itself if the scan did complete.
+    static QHash<QByteArray, Folder*> load(const QByteArray &root);
+
+    static void remove(const QByteArray &root);
+
+private:
+    struct Event {
+        const Folder *folder;
+        const Folder *parent; // of a folder started
+        bool completed;
+    };
+
+    void run() override;
+    void write(const QVector<Event> &events);
+    void flush();
+    quint32 writeStarted(const Folder *folder, quint32 parent);
+    void writeCompleted(const Folder *folder, quint32 id);
+
+    QByteArray m_root;
+    unsigned long m_interval; // ms
+    QFile m_file;
+    QByteArray m_buffer;
+
+    QMutex m_mutex; // guards the following
+    QWaitCondition m_wake;
+    QVector<Event> m_events;
+    bool m_stopping;
+    bool m_keep;
+
+    // only used by this thread
+    QHash<const Folder*, quint32> m_ids; // the folders started whose parent is not complete yet
+    quint32 m_nextId;
+};
+
+}
+
+#endif
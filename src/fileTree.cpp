@@ -21,10 +21,127 @@
 ***********************************************************************/
 
 #include "fileTree.h"
+#include "nodeArena.h"
 
 #include <QDir>
 #include <QUrl>
 
+#include <algorithm>
+
+bool File::s_apparentSizes = false;
+
+void Folder::deleteTree(Folder *tree)
+{
+    //the arena destroys the root too
+    if (tree) {
+        delete tree->m_arena;
+    }
+}
+
+void Folder::append(Folder *d, const char *name)
+{
+    d->m_name = d->m_arena->copyName(name);
+    append(d);
+}
+
+void Folder::append(NodeArena *arena, const char *name, FileSize size, FileSize apparentSize)
+{
+    File *file = arena->newFile(name, size, apparentSize);
+    file->m_parent = this;
+    append(file);
+}
+
+void Folder::insert(const char *name, FileSize size, FileSize apparentSize)
+{
+    Folder *root = this;
+    for (Folder *d = this; d; d = d->parent()) {
+        d->m_size += size;
+        d->m_apparentSize += apparentSize;
+        d->m_children++;
+        root = d;
+    }
+
+    File *file = root->m_arena->newFile(name, size, apparentSize);
+    file->m_parent = this;
+    files.append(file);
+}
+
+void Folder::remove(const File *f)
+{
+    Folder *root = detach(f);
+
+    //a scan still owns the tree if the root has no arena yet
+    if (root->m_arena) {
+        root->m_arena->release(const_cast<File*>(f));
+    }
+}
+
+Folder *Folder::detach(const File *f)
+{
+    files.removeAll(const_cast<File*>(f));
+
+    const uint count = 1 + (f->isFolder() ? static_cast<const Folder*>(f)->children() : 0);
+    Folder *root = this;
+    for (Folder *d = this; d; d = d->parent()) {
+        d->m_size -= f->m_size;
+        d->m_apparentSize -= f->m_apparentSize;
+        d->m_children -= count;
+        root = d;
+    }
+    return root;
+}
+
+Folder *Folder::insertFolder(const char *name)
+{
+    Folder *root = this;
+    for (Folder *d = this; d; d = d->parent()) {
+        d->m_children++;
+        root = d;
+    }
+
+    Folder *folder = root->m_arena->newFolder(name);
+    folder->m_parent = this;
+    files.append(folder);
+    return folder;
+}
+
+void Folder::copyFiles(NodeArena *arena, const Folder *folder)
+{
+    for (const File *f : folder->files) {
+        if (!f->isFolder()) {
+            append(arena, f->m_name, f->m_size, f->m_apparentSize);
+        }
+    }
+}
+
+void Folder::copyTree(NodeArena *arena, const Folder *folder)
+{
+    copyFiles(arena, folder);
+    for (const File *f : folder->files) {
+        if (!f->isFolder()) {
+            continue;
+        }
+
+        const Folder *subfolder = static_cast<const Folder*>(f);
+        Folder *copy = arena->newFolder(subfolder->m_name);
+        copy->m_changeTime = subfolder->m_changeTime;
+        copy->copyTree(arena, subfolder);
+        if (subfolder->isEstimated()) {
+            copy->setEstimated();
+            copy->setEstimate(subfolder->m_size, subfolder->m_apparentSize, subfolder->m_children, subfolder->m_margin);
+        }
+        append(copy);
+    }
+    std::sort(files.begin(), files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+}
+
+void Folder::takeOut(Folder *folder, const char *name)
+{
+    Folder *root = detach(folder);
+    folder->m_name = root->m_arena->copyName(name);
+    folder->m_parent = nullptr;
+}
+
 QString File::displayName() const {
     const QString decodedName = QFile::decodeName(m_name);
     return url().isLocalFile() ? QDir::toNativeSeparators(decodedName) : decodedName;
@@ -23,7 +23,6 @@
 #ifndef FILETREE_H
 #define FILETREE_H
 
-#include <QByteArray> //qstrdup
 #include <QFile> //decodeName()
 #include <KFormat>
 
@@ -33,18 +32,20 @@ typedef quint64 FileSize;
 typedef quint64 Dirsize;  //**** currently unused
 
 class Folder;
+class NodeArena;
 
+/**
+ * Files and folders are made by the NodeArena of the tree they belong to,
+ * and only ever deleted with all of it, see Folder::deleteTree(). What is
+ * removed from a tree is given back to the arena to be made again.
+ */
 class File
 {
 public:
     friend class Folder;
+    friend class NodeArena;
 
 public:
-    File(const char *name, FileSize size) : m_parent(nullptr), m_name(qstrdup(name)), m_size(size) {}
-    virtual ~File() {
-        delete [] m_name;
-    }
-
     Folder *parent() const {
         return m_parent;
     }
@@ -63,9 +64,26 @@ public:
      */
     QString displayName() const;
 
+    /// The size shown, allocatedSize() or apparentSize() as picked by setApparentSizes().
     FileSize size() const {
+        return s_apparentSizes ? m_apparentSize : m_size;
+    }
+    /// Space taken on disk, in whole blocks.
+    FileSize allocatedSize() const {
         return m_size;
     }
+    /// Size as reported by stat, holes in sparse files and compression included.
+    FileSize apparentSize() const {
+        return m_apparentSize;
+    }
+
+    static bool apparentSizes() {
+        return s_apparentSizes;
+    }
+    /// Only for the GUI thread while no scan is running, the trees have to be sorted again after.
+    static void setApparentSizes(bool apparent) {
+        s_apparentSizes = apparent;
+    }
 
     virtual bool isFolder() const {
         return false;
@@ -77,18 +95,23 @@ public:
      */
     QString displayPath(const Folder * = nullptr) const;
     QString humanReadableSize() const {
-        return KFormat().formatByteSize(m_size);
+        return KFormat().formatByteSize(size());
     }
 
     /** Builds a complete QUrl by walking up to root. */
     QUrl url(const Folder *root = nullptr) const;
 
 protected:
-    File(const char *name, FileSize size, Folder *parent) : m_parent(parent), m_name(qstrdup(name)), m_size(size) {}
+    /// @p name belongs to the arena making the file
+    File(const char *name, FileSize size, FileSize apparentSize, Folder *parent) : m_parent(parent), m_name(name), m_size(size), m_apparentSize(apparentSize) {}
+    ~File() {}
 
     Folder *m_parent; //0 if this is treeRoot
-    char *m_name; // partial path name (e.g. 'boot/' or 'foo.svg')
-    FileSize m_size; // in units of bytes; sum of all children's sizes
+    const char *m_name; // partial path name (e.g. 'boot/' or 'foo.svg')
+    FileSize m_size; // allocated, in units of bytes; sum of all children's sizes
+    FileSize m_apparentSize; // likewise
+
+    static bool s_apparentSizes;
 
 private:
     File(const File&);
@@ -98,8 +121,26 @@ private:
 
 class Folder : public File
 {
+    friend class NodeArena;
+
 public:
-    Folder(const char *name) : File(name, 0), m_children(0) {} //DON'T pass the full path!
+    /// Deletes the tree @p tree is the root of, with the arena it owns.
+    static void deleteTree(Folder *tree);
+
+    /// What the tree this is the root of is made of, 0 below the root.
+    NodeArena *arena() const {
+        return m_arena;
+    }
+    /// Makes this the root owning @p arena.
+    void setArena(NodeArena *arena) {
+        m_arena = arena;
+    }
+    /// Lets go of arena(), for a tree that is about to join another.
+    NodeArena *takeArena() {
+        NodeArena *arena = m_arena;
+        m_arena = nullptr;
+        return arena;
+    }
 
     uint children() const {
         return m_children;
@@ -108,32 +149,141 @@ public:
         return true;
     }
 
+    /// A time limited scan did not get to list this folder, its size is a guess.
+    bool isEstimated() const {
+        return m_estimated;
+    }
+    void setEstimated() {
+        m_estimated = true;
+    }
+
+    /// How far off the estimate may be, in percent of it with 95% confidence. 0 if unknown.
+    uint estimateMargin() const {
+        return m_margin;
+    }
+
+    /// st_ctime of the folder when it was listed, in ns since the epoch, 0 if unknown.
+    /// It moves on whenever an entry is added, removed or renamed in the folder.
+    qint64 changeTime() const {
+        return m_changeTime;
+    }
+    void setChangeTime(qint64 time) {
+        m_changeTime = time;
+    }
+
+    /// Sets the guessed sizes and file count of an unlisted folder, updating its parents too.
+    void setEstimate(FileSize size, FileSize apparentSize, uint children, uint margin = 0) {
+        for (Folder *d = m_parent; d; d = d->parent()) {
+            d->m_size = d->m_size - m_size + size;
+            d->m_apparentSize = d->m_apparentSize - m_apparentSize + apparentSize;
+            d->m_children = d->m_children - m_children + children;
+        }
+        m_size = size;
+        m_apparentSize = apparentSize;
+        m_children = children;
+        m_margin = quint8(qMin(margin, 255u));
+    }
+
     ///appends a Folder
-    void append(Folder *d, const char *name=nullptr)
+    void append(Folder *d)
     {
-        if (name) {
-            delete [] d->m_name;
-            d->m_name = qstrdup(name);
-        } //directories that had a fullpath copy just their names this way
-
         m_children += d->children(); //doesn't include the dir itself
-        d->m_parent = this;
+        if (d->m_parent != this) { //unless link() set it already, it may be read meanwhile
+            d->m_parent = this;
+        }
         append((File*)d); //will add 1 to filecount for the dir itself
     }
 
-    ///appends a File
-    void append(const char *name, FileSize size)
+    /// Makes this the parent of @p d ahead of append(), for a folder that is
+    /// shown while this one is still being assembled.
+    void link(Folder *d)
     {
-        append(new File(name, size, this));
+        d->m_parent = this;
     }
 
-    /// removes a file
-    void remove(const File *f) {
-        files.removeAll(const_cast<File*>(f));
+    /// Appends the root of another tree, which had its full path for a name
+    /// and is named @p name from now on. Its arena is left to the caller to
+    /// adopt, see takeArena().
+    void append(Folder *d, const char *name);
+
+    ///appends a File made from @p arena
+    void append(NodeArena *arena, const char *name, FileSize size, FileSize apparentSize);
+
+    ///appends a File that takes up just as much space as it claims
+    void append(NodeArena *arena, const char *name, FileSize size)
+    {
+        append(arena, name, size, size);
+    }
+
+    /// Adds a file to a folder of a complete tree, updating its parents too.
+    /// It is made of the arena of the root.
+    void insert(const char *name, FileSize size, FileSize apparentSize);
+
+    /// Likewise adds an empty folder, which is returned.
+    Folder *insertFolder(const char *name);
 
+    /// Sets the sizes of the file @p f, updating its parents too.
+    void resize(File *f, FileSize size, FileSize apparentSize)
+    {
         for (Folder *d = this; d; d = d->parent()) {
-            d->m_size -= f->size();
-            d->m_children--;
+            d->m_size = d->m_size - f->m_size + size;
+            d->m_apparentSize = d->m_apparentSize - f->m_apparentSize + apparentSize;
+        }
+        f->m_size = size;
+        f->m_apparentSize = apparentSize;
+    }
+
+    /// Removes a file, or a folder with all it holds, from a complete tree.
+    /// Their memory is reused by the arena of the root, @p f is gone after.
+    void remove(const File *f);
+
+    /// Copies the files of @p folder, which may be in another tree, here.
+    void copyFiles(NodeArena *arena, const Folder *folder);
+
+    /// Likewise copies all @p folder holds, its subfolders with all they hold too.
+    void copyTree(NodeArena *arena, const Folder *folder);
+
+    /// Moves the files of @p folder here, leaving it just the subfolders.
+    void takeFiles(Folder *folder)
+    {
+        QList<File*> folders;
+        for (File *f : folder->files) {
+            if (f->isFolder()) {
+                folders.append(f);
+            } else {
+                f->m_parent = this;
+                append(f);
+            }
+        }
+        folder->files.swap(folders);
+    }
+
+    /// Shows the completed @p folder in this provisional one without taking
+    /// it over, its parent stays whatever the scan makes it.
+    void preview(Folder *folder)
+    {
+        m_children += 1 + folder->children();
+        m_size += folder->m_size;
+        m_apparentSize += folder->m_apparentSize;
+        files.append(folder);
+    }
+
+    /// Takes @p folder out of this one, to be the root of a tree of its own
+    /// named @p name. It is still made of the arena of this tree.
+    void takeOut(Folder *folder, const char *name);
+
+    /// Puts the freshly scanned @p folder in the place of the unlisted @p old,
+    /// which is let go. The arena of @p folder is left to the caller to adopt.
+    void replace(Folder *old, Folder *folder)
+    {
+        folder->m_name = old->m_name;
+        folder->m_parent = this;
+        files[files.indexOf(old)] = folder;
+
+        for (Folder *d = this; d; d = d->parent()) {
+            d->m_size = d->m_size - old->m_size + folder->m_size;
+            d->m_apparentSize = d->m_apparentSize - old->m_apparentSize + folder->m_apparentSize;
+            d->m_children += folder->children() - old->children();
         }
     }
 
@@ -147,11 +297,23 @@ private:
         // since in turn we too only are added to our parent when we are have
         // been scanned already.
         m_children++;
-        m_size += p->size();
+        m_size += p->m_size;
+        m_apparentSize += p->m_apparentSize;
         files.append(p);
     }
 
+    /// Takes @p f out of this folder, minding the sizes of all above.
+    /// @return the root of the tree
+    Folder *detach(const File *f);
+
+    Folder(const char *name) : File(name, 0, 0, nullptr), m_arena(nullptr), m_children(0), m_estimated(false), m_margin(0), m_changeTime(0) {} //DON'T pass the full path!
+    ~Folder() {}
+
+    NodeArena *m_arena;
     uint m_children;
+    bool m_estimated;
+    quint8 m_margin;
+    qint64 m_changeTime;
 
 private:
     Folder(const Folder&); //undefined
@@ -0,0 +1,190 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "define.h"
+#include "fileTree.h"
+#include "listingImport.h"
+#include "localLister.h"
+#include "scanContext.h"
+#include "snapshot.h"
+#include "treeWriter.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <KAboutData>
+#include <KLocalizedString>
+
+#include <stdio.h>
+#include <string.h> //strerror()
+
+using namespace Filelight;
+
+/**
+ * filelight-scan, the scan of Filelight without its window, for servers,
+ * cron jobs and scripts. Only needs QtCore and the KDE frameworks below
+ * the GUI ones.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    KLocalizedString::setApplicationDomain("filelight");
+
+    //shares Filelight's settings and cache dir
+    KAboutData about(
+        QStringLiteral(APP_NAME),
+        i18n("Filelight Scan"),
+        QStringLiteral(APP_VERSION),
+        i18n("Scans a folder the way Filelight does and writes out what it found"),
+        KAboutLicense::GPL,
+        QString(),
+        QString(),
+        QStringLiteral("https://utils.kde.org/projects/filelight")
+    );
+    KAboutData::setApplicationData(about);
+    app.setOrganizationName(QStringLiteral("KDE"));
+
+    const QCommandLineOption formatOption({ QStringLiteral("f"), QStringLiteral("format") },
+        i18n("What to write: du for size and path per line, json for one JSON object per line, ncdu for the export format of ncdu, snapshot for the file Filelight keeps scans in"),
+        i18n("format"), QStringLiteral("du"));
+    const QCommandLineOption outputOption({ QStringLiteral("o"), QStringLiteral("output") },
+        i18n("Write to this file instead of the standard output, required for snapshots"), i18n("file"));
+    const QCommandLineOption nullOption({ QStringLiteral("0"), QStringLiteral("null") },
+        i18n("End du lines with NUL instead of newline"));
+    const QCommandLineOption apparentOption(QStringLiteral("apparent-sizes"),
+        i18n("Write the sizes files claim rather than the space they take (du format)"));
+    const QCommandLineOption mountsOption({ QStringLiteral("x"), QStringLiteral("cross-mounts") },
+        i18n("Scan the filesystems mounted below the folder too"));
+    const QCommandLineOption threadsOption(QStringLiteral("threads"),
+        i18n("Scan with this many threads, 0 for one per core"), i18n("count"));
+    const QCommandLineOption excludeOption(QStringLiteral("exclude"),
+        i18n("Leave out this folder, may be given more than once"), i18n("folder"));
+    const QCommandLineOption importOption(QStringLiteral("import"),
+        i18n("Read the output of du, find or ncdu instead of scanning a folder, - for the standard input"), i18n("listing"));
+
+    QCommandLineParser options;
+    options.addHelpOption();
+    options.addVersionOption();
+    options.addOptions({ formatOption, outputOption, nullOption, apparentOption, mountsOption, threadsOption, excludeOption, importOption });
+    options.addPositionalArgument(QStringLiteral("folder"), i18n("Folder to scan"), i18n("folder | --import listing"));
+    about.setupCommandLine(&options);
+    options.process(app);
+    about.processCommandLine(&options);
+
+    const QString format = options.value(formatOption);
+    if (format != QLatin1String("du") && format != QLatin1String("json") && format != QLatin1String("ncdu") && format != QLatin1String("snapshot")) {
+        fprintf(stderr, "%s\n", qPrintable(i18n("Unknown format: %1", format)));
+        return 2;
+    }
+    if (format == QLatin1String("snapshot") && !options.isSet(outputOption)) {
+        fprintf(stderr, "%s\n", qPrintable(i18n("Snapshots are written to a file, pass --output")));
+        return 2;
+    }
+    const bool importing = options.isSet(importOption);
+    if (options.positionalArguments().size() != (importing ? 0 : 1)) {
+        options.showHelp(2);
+    }
+
+    QString path;
+    if (!importing) {
+        path = QDir::cleanPath(QDir::current().absoluteFilePath(options.positionalArguments().first()));
+        if (!QFileInfo(path).isDir()) {
+            fprintf(stderr, "%s\n", qPrintable(i18n("%1 is not a folder", path)));
+            return 1;
+        }
+        if (!path.endsWith(QDir::separator())) path += QDir::separator();
+    }
+
+    //the settings of Filelight, but always an exact scan that leaves nothing on disk
+    Config::read();
+    Config::scanTimeBudget = 0;
+    Config::sampleProbes = 0;
+    Config::scanSnapshots = false;
+    Config::checkpointInterval = 0;
+    if (options.isSet(mountsOption)) {
+        Config::scanAcrossMounts = true;
+    }
+    if (options.isSet(threadsOption)) {
+        Config::scanThreads = options.value(threadsOption).toUInt();
+    }
+    Config::skipList += options.values(excludeOption);
+    File::setApparentSizes(options.isSet(apparentOption));
+
+    ScanContext context;
+    Folder *tree = nullptr;
+    if (importing) {
+        //converts between the formats, ncdu to du say
+        ListingImport import(options.value(importOption), &context);
+        QObject::connect(&import, &ListingImport::branchCompleted, [&tree](Folder *completed) {
+            tree = completed;
+        });
+        import.start();
+        import.wait();
+    } else {
+        LocalLister lister(path, new QHash<QByteArray, Folder*>, &context);
+        QObject::connect(&lister, &LocalLister::branchCompleted, [&tree](Folder *completed) {
+            tree = completed;
+        });
+        lister.start();
+        lister.wait();
+    }
+
+    for (const ScanErrors::Error &error : context.errors().errors()) {
+        if (importing && error.count) {
+            fprintf(stderr, "filelight-scan: %s\n", qPrintable(i18np("cannot read a line of %2", "cannot read %1 lines of %2",
+                                                                     error.count, QFile::decodeName(error.path))));
+        } else if (error.count) {
+            fprintf(stderr, "filelight-scan: %s\n", qPrintable(i18np("cannot examine an entry of %2: %3", "cannot examine %1 entries of %2: %3",
+                                                                     error.count, QFile::decodeName(error.path), QString::fromLocal8Bit(strerror(error.error)))));
+        } else {
+            fprintf(stderr, "filelight-scan: %s\n", qPrintable(i18n("cannot read %1: %2", QFile::decodeName(error.path), QString::fromLocal8Bit(strerror(error.error)))));
+        }
+    }
+    if (!tree) {
+        return 1;
+    }
+
+    bool written;
+    if (format == QLatin1String("snapshot")) {
+        written = Snapshot::save(tree, options.value(outputOption));
+    } else {
+        QFile output(options.value(outputOption));
+        if (options.isSet(outputOption) ? output.open(QIODevice::WriteOnly | QIODevice::Truncate) : output.open(stdout, QIODevice::WriteOnly)) {
+            TreeWriter writer(&output, format == QLatin1String("json") ? TreeWriter::JsonLines
+                                     : format == QLatin1String("ncdu") ? TreeWriter::Ncdu : TreeWriter::Du);
+            writer.setNullTerminated(options.isSet(nullOption));
+            written = writer.write(tree);
+        } else {
+            written = false;
+        }
+        written = output.flush() && written;
+    }
+    if (!written) {
+        fprintf(stderr, "filelight-scan: %s\n", qPrintable(i18n("cannot write the results")));
+        return 1;
+    }
+
+    //like du, anything that could not be read shows in the exit status
+    return context.errors().unreadableFolders() || context.errors().failedEntries() ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "inodeSet.h"
+
+#include <QMutexLocker>
+
+#include <new>
+#include <string.h>
+
+namespace Filelight
+{
+
+InodeSet::InodeSet()
+        : m_shards(static_cast<Shard*>(qMallocAligned(ShardCount * sizeof(Shard), CacheLine)))
+{
+    Q_CHECK_PTR(m_shards);
+    for (int i = 0; i < ShardCount; ++i) {
+        new (m_shards + i) Shard;
+    }
+}
+
+InodeSet::~InodeSet()
+{
+    clear();
+    for (int i = 0; i < ShardCount; ++i) {
+        m_shards[i].~Shard();
+    }
+    qFreeAligned(m_shards);
+}
+
+quint64
+InodeSet::hash(quint64 device, quint64 inode)
+{
+    // splitmix64 finalizer, inode numbers are often sequential
+    quint64 h = inode ^ (device * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void
+InodeSet::grow(Shard &shard)
+{
+    const uint capacity = shard.capacity ? shard.capacity * 2 : uint(InitialCapacity);
+    Slot *slots = new Slot[capacity];
+    memset(slots, 0, capacity * sizeof(Slot));
+
+    const uint mask = capacity - 1;
+    for (uint i = 0; i < shard.capacity; ++i) {
+        const Slot &slot = shard.slots[i];
+        if (!slot.device) {
+            continue;
+        }
+        // the low bits picked the shard, probe with the high ones
+        uint pos = uint(hash(slot.device - 1, slot.inode) >> 32) & mask;
+        while (slots[pos].device) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = slot;
+    }
+
+    delete [] shard.slots;
+    shard.slots = slots;
+    shard.capacity = capacity;
+}
+
+bool
+InodeSet::insert(quint64 device, quint64 inode)
+{
+    const quint64 h = hash(device, inode);
+    Shard &shard = m_shards[h % ShardCount];
+    QMutexLocker locker(&shard.mutex);
+
+    // keep the load factor under 3/4
+    if ((shard.size + 1) * 4 > shard.capacity * 3) {
+        grow(shard);
+    }
+
+    const uint mask = shard.capacity - 1;
+    uint pos = uint(h >> 32) & mask;
+    while (shard.slots[pos].device) {
+        if (shard.slots[pos].device == device + 1 && shard.slots[pos].inode == inode) {
+            return false;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    shard.slots[pos].device = device + 1;
+    shard.slots[pos].inode = inode;
+    ++shard.size;
+    return true;
+}
+
+void
+InodeSet::clear()
+{
+    for (int i = 0; i < ShardCount; ++i) {
+        Shard &shard = m_shards[i];
+        QMutexLocker locker(&shard.mutex);
+        delete [] shard.slots;
+        shard.slots = nullptr;
+        shard.capacity = 0;
+        shard.size = 0;
+    }
+}
+
+quint64
+InodeSet::count() const
+{
+    quint64 count = 0;
+    for (int i = 0; i < ShardCount; ++i) {
+        const Shard &shard = m_shards[i];
+        QMutexLocker locker(const_cast<QMutex*>(&shard.mutex));
+        count += shard.size;
+    }
+    return count;
+}
+
+}
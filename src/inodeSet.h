@@ -0,0 +1,81 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef INODESET_H
+#define INODESET_H
+
+#include <QMutex>
+#include <QtGlobal>
+
+namespace Filelight
+{
+
+/**
+ * Remembers (device, inode) pairs so that hard linked files are only
+ * counted once.
+ *
+ * Open addressing with linear probing, split in shards that each have
+ * their own lock so scan workers rarely wait for each other. Shards only
+ * allocate once the first key lands in them, so a tree without hard links
+ * costs nothing but the shard headers.
+ */
+class InodeSet
+{
+public:
+    InodeSet();
+    ~InodeSet();
+
+    /// @return true if the pair was not in the set yet
+    bool insert(quint64 device, quint64 inode);
+
+    void clear();
+
+    /// number of distinct pairs seen
+    quint64 count() const;
+
+private:
+    enum { ShardCount = 64, InitialCapacity = 64, CacheLine = 64 };
+
+    struct Slot {
+        quint64 device; // stored + 1, 0 marks an empty slot
+        quint64 inode;
+    };
+
+    /// One cache line, padded by hand: new only honours alignas() from C++17 on.
+    struct Shard {
+        QMutex mutex;
+        Slot *slots = nullptr;
+        uint capacity = 0; // always a power of two
+        uint size = 0;
+        char padding[CacheLine - sizeof(QMutex) - sizeof(Slot*) - 2 * sizeof(uint)];
+    };
+    static_assert(sizeof(Shard) == CacheLine, "a shard takes one cache line");
+
+    static quint64 hash(quint64 device, quint64 inode);
+    static void grow(Shard &shard);
+
+    Shard *m_shards; // ShardCount of them, starting on a cache line
+
+    Q_DISABLE_COPY(InodeSet)
+};
+
+}
+
+#endif
@@ -0,0 +1,1115 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "listingImport.h"
+
+#include "Config.h"
+#include "fileTree.h"
+#include "inodeSet.h"
+#include "nodeArena.h"
+#include "scanContext.h"
+#include "filelight_debug.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include <algorithm>
+#include <errno.h>
+#include <limits.h> //UINT_MAX
+#include <stdio.h> //stdin
+#include <string.h>
+
+namespace Filelight
+{
+
+enum {
+    BlockSize = 1 << 20, // read at a time from a stream
+    PartSize = 16 << 20, // smallest part of a mapped listing given a thread of its own
+    ReportLines = 1 << 16 // lines between looks at the abort flag and updates of the telemetry
+};
+
+static void
+sortFolder(Folder *folder)
+{
+    std::sort(folder->files.begin(), folder->files.end(), [](File *a, File *b) { return a->size() > b->size(); });
+}
+
+/// Moves everything in @p from to @p into, which must be open still.
+static void
+moveContents(Folder *into, Folder *from)
+{
+    into->takeFiles(from);
+    for (File *file : qAsConst(from->files)) {
+        into->append(static_cast<Folder*>(file));
+    }
+    from->files.clear();
+}
+
+/// A line of a du or find listing.
+struct Line {
+    const char *path;
+    int length;
+    FileSize size;
+};
+
+/// A name in a path.
+struct Component {
+    const char *name;
+    int length;
+};
+typedef QVarLengthArray<Component, 64> Components;
+
+/// Reads the line from @p data up to @p end. @return false if it is not "size path"
+static bool
+parseLine(const char *data, const char *end, Line *line)
+{
+    if (end > data && end[-1] == '\r') {
+        --end;
+    }
+
+    FileSize size = 0;
+    const char *p = data;
+    while (p < end && *p >= '0' && *p <= '9') {
+        size = size * 10 + FileSize(*p++ - '0');
+    }
+    //du separates with a tab, find with whatever -printf says
+    if (p == data || p + 1 >= end || (*p != '\t' && *p != ' ')) {
+        return false;
+    }
+
+    line->path = p + 1;
+    line->length = int(end - p - 1);
+    line->size = size;
+    return true;
+}
+
+/// Finds the last line that reads before @p start, which follows a terminator.
+/// @return where it begins, nullptr if there is none
+static const char*
+previousLine(const char *data, const char *start, char terminator, Line *line)
+{
+    while (start > data) {
+        const char *end = start - 1;
+        const char *begin = end;
+        while (begin > data && begin[-1] != terminator) {
+            --begin;
+        }
+        if (parseLine(begin, end, line)) {
+            return begin;
+        }
+        start = begin;
+    }
+    return nullptr;
+}
+
+static void
+split(const Line &line, Components *components)
+{
+    components->clear();
+    const char *p = line.path;
+    const char *end = line.path + line.length;
+    while (p < end) {
+        const char *slash = static_cast<const char*>(memchr(p, '/', size_t(end - p)));
+        if (!slash) {
+            slash = end;
+        }
+        if (slash > p) {
+            components->append({ p, int(slash - p) });
+        }
+        p = slash + 1;
+    }
+}
+
+static bool
+equals(const QByteArray &name, const Component &component)
+{
+    return name.size() == component.length && memcmp(name.constData(), component.name, size_t(component.length)) == 0;
+}
+
+/**
+ * Assembles the tree of a depth first listing line by line. The folders along
+ * the path of the last line are open, each is added to its parent once a line
+ * leaves it. The folder at the bottom stands for the root of the filesystem,
+ * or for the folder a relative listing was made in.
+ *
+ * A builder reading a part of a listing after the first starts with ghosts of
+ * the folders the part before leaves open. Joining the parts in order moves
+ * what went into the ghosts to the folders they stand for.
+ */
+class TreeBuilder
+{
+public:
+    explicit TreeBuilder(const char *rootName = "")
+            : files(0)
+            , bytes(0)
+            , malformed(0)
+            , m_pending(false)
+            , m_pendingSize(0)
+            , m_arena(new NodeArena)
+    {
+        m_levels.append({ m_arena->newFolder(rootName), QByteArray(), QByteArray(), false });
+    }
+
+    ~TreeBuilder()
+    {
+        //unless finish() handed it over, along with everything
+        delete m_arena;
+    }
+
+    /// Starts with the folders the line @p previous leaves open, @p before
+    /// is the line before it if there is one.
+    void continueAfter(const Line &previous, const Line *before);
+
+    /// Reads the lines from @p data up to @p end, counting them in the
+    /// telemetry slot @p writer.
+    void parse(const char *data, const char *end, char terminator, const QAtomicInt *abort, ScanTelemetry *telemetry, int writer);
+
+    void add(const Line &line);
+
+    /// Takes over what @p next, which continued after this one, built.
+    void join(TreeBuilder &next);
+
+    /// Closes every folder. @return the folder at the bottom, holding everything
+    /// and owning the arena of all of it
+    Folder *finish();
+
+    quint64 files;
+    FileSize bytes;
+    quint64 malformed;
+
+private:
+    struct Level {
+        Folder *folder;
+        QByteArray name; // its path component
+        QByteArray lastClosed; // the subfolder closed last, du's total of it may follow
+        bool ghost;
+    };
+
+    void open(const char *name, int length, bool ghost);
+    void close();
+    void flush();
+
+    QVector<Level> m_levels;
+    QVector<Folder*> m_ghosts; // by depth, left in the arena once joined
+    QVector<bool> m_ghostsClosed;
+
+    //the last line read, a file or the folder find lists before its contents
+    bool m_pending;
+    QByteArray m_pendingName;
+    FileSize m_pendingSize;
+
+    QByteArray m_folderName;
+    Components m_components;
+    NodeArena *m_arena; // every part of a mapped listing has its own
+};
+
+void
+TreeBuilder::continueAfter(const Line &previous, const Line *before)
+{
+    m_levels.first().ghost = true;
+    m_ghosts.append(m_levels.first().folder);
+    m_ghostsClosed.append(false);
+
+    split(previous, &m_components);
+    if (m_components.isEmpty()) {
+        return;
+    }
+    for (int i = 0; i < m_components.size() - 1; ++i) {
+        open(m_components[i].name, m_components[i].length, true);
+    }
+
+    //du lists a folder after its contents, that line was its total
+    const Component &leaf = m_components.last();
+    if (before && before->length > previous.length && before->path[previous.length] == '/'
+            && memcmp(before->path, previous.path, size_t(previous.length)) == 0) {
+        m_levels.last().lastClosed = QByteArray(leaf.name, leaf.length);
+    } else {
+        m_pendingName = QByteArray(leaf.name, leaf.length);
+        m_pendingSize = previous.size;
+        m_pending = true;
+    }
+}
+
+void
+TreeBuilder::parse(const char *data, const char *end, char terminator, const QAtomicInt *abort, ScanTelemetry *telemetry, int writer)
+{
+    quint64 lines = 0;
+    quint64 reportedFiles = files;
+    FileSize reportedBytes = bytes;
+    for (const char *p = data; p < end;) {
+        const char *lineEnd = static_cast<const char*>(memchr(p, terminator, size_t(end - p)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        if (lineEnd > p) {
+            Line line;
+            if (parseLine(p, lineEnd, &line)) {
+                add(line);
+            } else {
+                ++malformed;
+            }
+        }
+        p = lineEnd + 1;
+
+        if (++lines % ReportLines == 0) {
+            if (abort->loadAcquire()) {
+                return;
+            }
+            telemetry->add(writer, ScanTelemetry::Files, files - reportedFiles);
+            telemetry->add(writer, ScanTelemetry::Bytes, bytes - reportedBytes);
+            reportedFiles = files;
+            reportedBytes = bytes;
+        }
+    }
+    telemetry->add(writer, ScanTelemetry::Files, files - reportedFiles);
+    telemetry->add(writer, ScanTelemetry::Bytes, bytes - reportedBytes);
+}
+
+void
+TreeBuilder::add(const Line &line)
+{
+    split(line, &m_components);
+    if (m_components.isEmpty()) {
+        //du's total of the filesystem root comes last
+        while (m_levels.size() > 1) {
+            close();
+        }
+        flush();
+        return;
+    }
+
+    //leave the folders this line is not in, enter those it is in
+    const int parents = m_components.size() - 1;
+    int depth = 0;
+    while (depth < parents && depth + 1 < m_levels.size() && equals(m_levels[depth + 1].name, m_components[depth])) {
+        ++depth;
+    }
+    while (m_levels.size() > depth + 1) {
+        close();
+    }
+    for (int i = depth; i < parents; ++i) {
+        open(m_components[i].name, m_components[i].length, false);
+    }
+
+    flush();
+    const Component &leaf = m_components.last();
+    if (equals(m_levels.last().lastClosed, leaf)) {
+        return; //du's total of the folder just closed
+    }
+    m_pendingName.resize(leaf.length);
+    memcpy(m_pendingName.data(), leaf.name, size_t(leaf.length));
+    m_pendingSize = line.size;
+    m_pending = true;
+}
+
+void
+TreeBuilder::open(const char *name, int length, bool ghost)
+{
+    if (m_pending) {
+        if (!ghost && m_pendingName.size() == length && memcmp(m_pendingName.constData(), name, size_t(length)) == 0) {
+            m_pending = false; //find's line for the folder itself
+        } else {
+            flush();
+        }
+    }
+
+    m_folderName.resize(length + 1);
+    memcpy(m_folderName.data(), name, size_t(length));
+    m_folderName.data()[length] = '/';
+    Folder *folder = m_arena->newFolder(m_folderName.constData());
+    m_levels.append({ folder, QByteArray(name, length), QByteArray(), ghost });
+    if (ghost) {
+        m_ghosts.append(folder);
+        m_ghostsClosed.append(false);
+    }
+}
+
+void
+TreeBuilder::close()
+{
+    flush();
+    const Level level = m_levels.takeLast();
+    if (level.ghost) {
+        m_ghostsClosed[m_levels.size()] = true; //the part before gets to add it
+    } else {
+        sortFolder(level.folder);
+        m_levels.last().folder->append(level.folder);
+    }
+    m_levels.last().lastClosed = level.name;
+}
+
+void
+TreeBuilder::flush()
+{
+    if (m_pending) {
+        m_levels.last().folder->append(m_arena, m_pendingName.constData(), m_pendingSize);
+        ++files;
+        bytes += m_pendingSize;
+        m_pending = false;
+    }
+}
+
+void
+TreeBuilder::join(TreeBuilder &next)
+{
+    Q_ASSERT(next.m_ghosts.size() == m_levels.size());
+
+    //next read the last line again, deepest first its ghosts are merged and
+    //those it closed are closed here
+    m_pending = false;
+    int open = next.m_ghosts.size();
+    for (int depth = next.m_ghosts.size() - 1; depth >= 0; --depth) {
+        Folder *ghost = next.m_ghosts[depth];
+        moveContents(m_levels[depth].folder, ghost);
+        if (next.m_ghostsClosed[depth]) {
+            close();
+            open = depth;
+        }
+    }
+
+    for (int i = 0; i < open; ++i) {
+        if (!next.m_levels[i].lastClosed.isEmpty()) {
+            m_levels[i].lastClosed = next.m_levels[i].lastClosed;
+        }
+    }
+    for (int i = open; i < next.m_levels.size(); ++i) {
+        m_levels.append(next.m_levels[i]);
+    }
+    m_pending = next.m_pending;
+    m_pendingName = next.m_pendingName;
+    m_pendingSize = next.m_pendingSize;
+    files += next.files;
+    bytes += next.bytes;
+    malformed += next.malformed;
+    m_arena->adopt(next.m_arena);
+
+    next.m_levels.clear();
+    next.m_ghosts.clear();
+    next.m_ghostsClosed.clear();
+    next.m_pending = false;
+}
+
+Folder*
+TreeBuilder::finish()
+{
+    flush();
+    while (m_levels.size() > 1) {
+        close();
+    }
+    Folder *folder = m_levels.takeFirst().folder;
+    sortFolder(folder);
+    folder->setArena(m_arena);
+    m_arena = nullptr;
+    return folder;
+}
+
+/// Takes the folder @p line names out of @p top, the folder everything was
+/// listed in, as long as it holds nothing else.
+static Folder*
+extractRoot(Folder *top, const Line &line)
+{
+    Components components;
+    split(line, &components);
+
+    Folder *root = top;
+    QByteArray name(line.length && line.path[0] == '/' ? "/" : "");
+    for (const Component &component : qAsConst(components)) {
+        if (root->files.size() != 1 || !root->files.first()->isFolder()) {
+            break;
+        }
+        Folder *folder = static_cast<Folder*>(root->files.first());
+        const char *folderName = folder->name8Bit();
+        if (qstrlen(folderName) != uint(component.length) + 1 || memcmp(folderName, component.name, size_t(component.length)) != 0) {
+            break;
+        }
+        name += folderName;
+        root = folder;
+    }
+
+    if (root == top) {
+        Folder *tree = top->arena()->newFolder(name.isEmpty() ? "./" : name.constData());
+        moveContents(tree, top);
+        sortFolder(tree);
+        tree->setArena(top->takeArena());
+        return tree;
+    }
+
+    //what is left above it are folders holding nothing but the next one,
+    //they stay in the arena
+    root->parent()->takeOut(root, name.constData());
+    root->setArena(top->takeArena());
+    return root;
+}
+
+/// Parses a part of a mapped listing.
+class ImportWorker : public QThread
+{
+public:
+    ImportWorker(TreeBuilder *builder, const char *data, const char *end, char terminator,
+                 const QAtomicInt *abort, ScanTelemetry *telemetry, int writer)
+            : m_builder(builder)
+            , m_data(data)
+            , m_end(end)
+            , m_terminator(terminator)
+            , m_abort(abort)
+            , m_telemetry(telemetry)
+            , m_writer(writer) {}
+
+protected:
+    void run() override {
+        m_builder->parse(m_data, m_end, m_terminator, m_abort, m_telemetry, m_writer);
+    }
+
+private:
+    TreeBuilder *m_builder;
+    const char *m_data;
+    const char *m_end;
+    const char m_terminator;
+    const QAtomicInt *m_abort;
+    ScanTelemetry *m_telemetry;
+    const int m_writer;
+};
+
+/**
+ * Reads an ncdu export, which nests a folder's contents in an array after
+ * the object describing it:
+ * [1, 2, {metadata}, [{root}, {file}, [{folder}, {file}, ...], ...]]
+ */
+class NcduReader
+{
+public:
+    NcduReader(const char *data, qint64 size, QIODevice *device)
+            : files(0)
+            , bytes(0)
+            , m_pos(data)
+            , m_end(data + size)
+            , m_device(device) {}
+
+    /// @return the tree, nullptr if the export is cut short or broken
+    Folder *read(const QAtomicInt *abort, ScanTelemetry *telemetry);
+
+    quint64 files;
+    FileSize bytes;
+
+private:
+    struct Entry {
+        QByteArray name;
+        FileSize size;
+        FileSize apparentSize;
+        quint64 device;
+        quint64 inode;
+        bool hasDevice;
+        bool hardLinked;
+        bool skip; // excluded or not a regular file
+    };
+
+    bool readEntry(Entry *entry);
+    bool readString(QByteArray *string);
+    bool readNumber(quint64 *number);
+    bool readBool(bool *value);
+    bool skipValue();
+
+    int peek() {
+        if (m_pos == m_end && !refill()) {
+            return -1;
+        }
+        return uchar(*m_pos);
+    }
+    int skipSpace() {
+        int c;
+        while ((c = peek()) == ' ' || c == '\n' || c == '\t' || c == '\r') {
+            ++m_pos;
+        }
+        return c;
+    }
+    bool expect(char c) {
+        if (skipSpace() != uchar(c)) {
+            return false;
+        }
+        ++m_pos;
+        return true;
+    }
+    bool refill();
+
+    const char *m_pos;
+    const char *m_end;
+    QIODevice *m_device; // nullptr when all of it is mapped
+    QByteArray m_block;
+    QByteArray m_key;
+};
+
+bool
+NcduReader::refill()
+{
+    if (!m_device) {
+        return false;
+    }
+    m_block.resize(BlockSize);
+    const qint64 read = m_device->read(m_block.data(), BlockSize);
+    if (read <= 0) {
+        return false;
+    }
+    m_pos = m_block.constData();
+    m_end = m_pos + read;
+    return true;
+}
+
+Folder*
+NcduReader::read(const QAtomicInt *abort, ScanTelemetry *telemetry)
+{
+    struct Open {
+        Folder *folder;
+        quint64 device;
+    };
+
+    quint64 major = 0, minor = 0;
+    if (!expect('[') || !readNumber(&major) || major != 1 || !expect(',') || !readNumber(&minor) || !expect(',')
+            || !skipValue() || !expect(',') || !expect('[')) {
+        return nullptr;
+    }
+
+    InodeSet inodes;
+    QVector<Open> open;
+    Entry entry;
+    quint64 reportedFiles = 0;
+    FileSize reportedBytes = 0;
+    bool failed = false;
+    NodeArena *arena = new NodeArena;
+
+    //just inside the array of a folder, which starts with the folder itself
+    while (!failed && readEntry(&entry)) {
+        //the root is named by its path, which may end in a separator already
+        if (!open.isEmpty() || !entry.name.endsWith('/')) {
+            entry.name += '/';
+        }
+        open.append({ arena->newFolder(entry.name.constData()), entry.hasDevice || open.isEmpty() ? entry.device : open.last().device });
+
+        //its contents, up to the end of it or the start of a subfolder
+        forever {
+            int c = skipSpace();
+            if (c == ',') {
+                ++m_pos;
+                if (skipSpace() == '[') {
+                    ++m_pos;
+                    break;
+                }
+                if (!readEntry(&entry)) {
+                    failed = true;
+                    break;
+                }
+                if (entry.skip) {
+                    continue;
+                }
+                //only the first link is charged for the data, as when scanning
+                if (entry.hardLinked && Config::countHardlinksOnce
+                        && !inodes.insert(entry.hasDevice ? entry.device : open.last().device, entry.inode)) {
+                    entry.size = entry.apparentSize = 0;
+                }
+                open.last().folder->append(arena, entry.name.constData(), entry.size, entry.apparentSize);
+                bytes += entry.size;
+                if (++files % ReportLines == 0) {
+                    if (abort->loadAcquire()) {
+                        failed = true;
+                        break;
+                    }
+                    telemetry->add(0, ScanTelemetry::Files, files - reportedFiles);
+                    telemetry->add(0, ScanTelemetry::Bytes, bytes - reportedBytes);
+                    reportedFiles = files;
+                    reportedBytes = bytes;
+                }
+            } else if (c == ']') {
+                ++m_pos;
+                Folder *folder = open.takeLast().folder;
+                sortFolder(folder);
+                if (open.isEmpty()) {
+                    telemetry->add(0, ScanTelemetry::Files, files - reportedFiles);
+                    telemetry->add(0, ScanTelemetry::Bytes, bytes - reportedBytes);
+                    folder->setArena(arena);
+                    return folder;
+                }
+                open.last().folder->append(folder);
+            } else {
+                failed = true;
+                break;
+            }
+        }
+    }
+
+    //whatever was read goes with the arena
+    delete arena;
+    return nullptr;
+}
+
+bool
+NcduReader::readEntry(Entry *entry)
+{
+    entry->name.resize(0);
+    entry->size = entry->apparentSize = 0;
+    entry->device = entry->inode = 0;
+    entry->hasDevice = entry->hardLinked = entry->skip = false;
+
+    if (!expect('{')) {
+        return false;
+    }
+    if (skipSpace() == '}') {
+        ++m_pos;
+        return true;
+    }
+
+    forever {
+        if (skipSpace() != '"' || !readString(&m_key) || !expect(':')) {
+            return false;
+        }
+
+        bool ok;
+        if (m_key == "name") {
+            ok = readString(&entry->name);
+        } else if (m_key == "dsize") {
+            ok = readNumber(&entry->size);
+        } else if (m_key == "asize") {
+            ok = readNumber(&entry->apparentSize);
+        } else if (m_key == "dev") {
+            ok = readNumber(&entry->device);
+            entry->hasDevice = true;
+        } else if (m_key == "ino") {
+            ok = readNumber(&entry->inode);
+        } else if (m_key == "hlnkc") {
+            ok = readBool(&entry->hardLinked);
+        } else if (m_key == "notreg") {
+            bool notRegular = false;
+            ok = readBool(&notRegular);
+            entry->skip |= notRegular;
+        } else if (m_key == "excluded") {
+            ok = skipValue();
+            entry->skip = true;
+        } else {
+            ok = skipValue();
+        }
+        if (!ok) {
+            return false;
+        }
+
+        const int c = skipSpace();
+        if (c < 0) {
+            return false;
+        }
+        ++m_pos;
+        if (c == '}') {
+            return true;
+        } else if (c != ',') {
+            return false;
+        }
+    }
+}
+
+bool
+NcduReader::readString(QByteArray *string)
+{
+    static const auto hexValue = [](int c) {
+        return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+    };
+
+    if (string) {
+        string->resize(0);
+    }
+    ++m_pos; //the opening quote
+
+    forever {
+        if (peek() < 0) {
+            return false;
+        }
+        //copy up to the next quote or escape in one go
+        const char *start = m_pos;
+        while (m_pos < m_end && *m_pos != '"' && *m_pos != '\\') {
+            ++m_pos;
+        }
+        if (string && m_pos > start) {
+            string->append(start, int(m_pos - start));
+        }
+        if (m_pos == m_end) {
+            continue;
+        }
+        if (*m_pos++ == '"') {
+            return true;
+        }
+
+        int c = peek();
+        if (c < 0) {
+            return false;
+        }
+        ++m_pos;
+        switch (c) {
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u': {
+            uint code = 0;
+            for (int i = 0; i < 4; ++i) {
+                const int digit = hexValue(peek());
+                if (digit < 0) {
+                    return false;
+                }
+                ++m_pos;
+                code = code << 4 | uint(digit);
+            }
+            if (!string) {
+                continue;
+            }
+            //surrogate pairs are left alone, names are bytes and ncdu only escapes control characters
+            if (code < 0x80) {
+                string->append(char(code));
+            } else if (code < 0x800) {
+                string->append(char(0xc0 | code >> 6));
+                string->append(char(0x80 | (code & 0x3f)));
+            } else {
+                string->append(char(0xe0 | code >> 12));
+                string->append(char(0x80 | ((code >> 6) & 0x3f)));
+                string->append(char(0x80 | (code & 0x3f)));
+            }
+            continue;
+        }
+        default:
+            break; // '"', '\\' and '/' stand for themselves
+        }
+        if (string) {
+            string->append(char(c));
+        }
+    }
+}
+
+bool
+NcduReader::readNumber(quint64 *number)
+{
+    int c = skipSpace();
+    if (c < '0' || c > '9') {
+        return false;
+    }
+    quint64 value = 0;
+    while ((c = peek()) >= '0' && c <= '9') {
+        value = value * 10 + quint64(c - '0');
+        ++m_pos;
+    }
+    //sizes are whole, but a fraction or exponent would still be valid JSON
+    while ((c = peek()) == '.' || c == 'e' || c == 'E' || c == '+' || c == '-' || (c >= '0' && c <= '9')) {
+        ++m_pos;
+    }
+    *number = value;
+    return true;
+}
+
+bool
+NcduReader::readBool(bool *value)
+{
+    const int c = skipSpace();
+    const char *word = c == 't' ? "true" : c == 'f' ? "false" : c == 'n' ? "null" : nullptr;
+    if (!word) {
+        return false;
+    }
+    for (const char *p = word; *p; ++p) {
+        if (peek() != *p) {
+            return false;
+        }
+        ++m_pos;
+    }
+    *value = c == 't';
+    return true;
+}
+
+bool
+NcduReader::skipValue()
+{
+    int depth = 0;
+    forever {
+        int c = skipSpace();
+        if (c < 0) {
+            return false;
+        } else if (c == '"') {
+            if (!readString(nullptr)) {
+                return false;
+            }
+        } else if (c == '[' || c == '{') {
+            ++m_pos;
+            ++depth;
+            continue;
+        } else if (c == ']' || c == '}' || c == ',' || c == ':') {
+            if (depth == 0) {
+                return false;
+            }
+            ++m_pos;
+            if (c == ',' || c == ':') {
+                continue;
+            }
+            --depth;
+        } else {
+            //a number or literal
+            while ((c = peek()) >= 0 && c != ',' && c != ']' && c != '}' && c != ':' && c != ' ' && c != '\n' && c != '\t' && c != '\r') {
+                ++m_pos;
+            }
+        }
+        if (depth == 0) {
+            return true;
+        }
+    }
+}
+
+ListingImport::ListingImport(const QString &fileName, ScanContext *parent)
+        : QThread()
+        , m_fileName(fileName)
+        , m_parent(parent)
+        , m_malformed(0)
+        , m_partSize(PartSize)
+{
+}
+
+void
+ListingImport::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const bool standardInput = m_fileName == QLatin1String("-");
+    const QByteArray encodedName = standardInput ? QByteArray("-") : QFile::encodeName(m_fileName);
+    QFile file(standardInput ? QString() : m_fileName);
+    errno = 0;
+    if (!(standardInput ? file.open(stdin, QIODevice::ReadOnly) : file.open(QIODevice::ReadOnly))) {
+        const int error = errno ? errno : EIO;
+        qCDebug(FILELIGHT_LOG) << "Cannot read the listing" << m_fileName << file.errorString();
+        m_parent->m_telemetry.addError(0, error);
+        m_parent->m_errors.addFolder(encodedName, error);
+        m_parent->m_errors.finish();
+        emit branchCompleted(nullptr);
+        return;
+    }
+
+    //a regular file is mapped, even when it is the standard input
+    const qint64 size = file.isSequential() ? 0 : file.size();
+    const uchar *map = size > 0 ? file.map(0, size) : nullptr;
+    const char *data = reinterpret_cast<const char*>(map);
+
+    QByteArray start = map ? QByteArray::fromRawData(data, int(qMin<qint64>(size, 4096))) : file.peek(4096);
+    int first = 0;
+    while (first < start.size() && (start.at(first) == ' ' || start.at(first) == '\n' || start.at(first) == '\t' || start.at(first) == '\r')) {
+        ++first;
+    }
+
+    Folder *tree;
+    if (first < start.size() && start.at(first) == '[') {
+        tree = readNcdu(data, size, map ? nullptr : &file);
+    } else {
+        tree = map ? readLines(data, size) : readLines(&file);
+    }
+    if (map) {
+        file.unmap(const_cast<uchar*>(map));
+    }
+
+    if (m_malformed) {
+        m_parent->m_errors.addEntries(encodedName, EINVAL, uint(qMin<quint64>(m_malformed, UINT_MAX)));
+    }
+    m_parent->m_errors.finish();
+
+    if (m_parent->m_abort.loadAcquire()) {
+        qCDebug(FILELIGHT_LOG) << "Import successfully aborted";
+        Folder::deleteTree(tree);
+        tree = nullptr;
+    }
+
+    if (tree) {
+        const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+        qCDebug(FILELIGHT_LOG) << "Imported" << tree->children() << "entries from" << m_fileName << "in" << elapsed << "ms,"
+                               << (size / 1000 / elapsed) << "MB/s," << m_malformed << "lines not understood";
+    }
+    emit branchCompleted(tree);
+}
+
+Folder*
+ListingImport::readLines(const char *data, qint64 size)
+{
+    const char *end = data + size;
+    const char terminator = memchr(data, '\0', size_t(qMin<qint64>(size, BlockSize))) ? '\0' : '\n';
+
+    //cut at line ends, every part after the first carries on from the line before it
+    const int threads = qBound(1, Config::scanThreads ? int(Config::scanThreads) : QThread::idealThreadCount(), int(ScanTelemetry::MaxWriters));
+    const int parts = int(qBound<qint64>(1, size / m_partSize, threads));
+    QVector<const char*> bounds = { data };
+    for (int i = 1; i < parts; ++i) {
+        const char *p = data + size * i / parts;
+        p = static_cast<const char*>(memchr(p, terminator, size_t(end - p)));
+        if (p && p + 1 > bounds.last() && p + 1 < end) {
+            bounds.append(p + 1);
+        }
+    }
+    bounds.append(end);
+
+    QVector<TreeBuilder*> builders;
+    QVector<ImportWorker*> workers;
+    for (int i = 0; i + 1 < bounds.size(); ++i) {
+        TreeBuilder *builder = new TreeBuilder;
+        Line previous, before;
+        const char *previousStart = previousLine(data, bounds[i], terminator, &previous);
+        if (previousStart) {
+            builder->continueAfter(previous, previousLine(data, previousStart, terminator, &before) ? &before : nullptr);
+        }
+        builders.append(builder);
+        if (i > 0) {
+            workers.append(new ImportWorker(builder, bounds[i], bounds[i + 1], terminator, &m_parent->m_abort, &m_parent->m_telemetry, i));
+            workers.last()->start();
+        }
+    }
+    builders.first()->parse(bounds[0], bounds[1], terminator, &m_parent->m_abort, &m_parent->m_telemetry, 0);
+    for (ImportWorker *worker : qAsConst(workers)) {
+        worker->wait();
+    }
+    qDeleteAll(workers);
+
+    TreeBuilder *builder = builders.first();
+    for (int i = 1; i < builders.size(); ++i) {
+        builder->join(*builders[i]);
+        delete builders[i];
+    }
+    m_malformed += builder->malformed;
+    Folder *top = builder->finish();
+    delete builder;
+
+    //find lists the folder it was given first, du last
+    Line first, last;
+    const char *firstStart = data;
+    while (firstStart < end) {
+        const char *lineEnd = static_cast<const char*>(memchr(firstStart, terminator, size_t(end - firstStart)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        if (parseLine(firstStart, lineEnd, &first)) {
+            break;
+        }
+        firstStart = lineEnd + 1;
+    }
+    if (firstStart >= end) {
+        Folder::deleteTree(top);
+        return nullptr;
+    }
+    if (first.path[-1] == '\t') {
+        //the last line need not be terminated
+        const char *tail = end;
+        while (tail > data && tail[-1] != terminator) {
+            --tail;
+        }
+        if (!(tail < end && parseLine(tail, end, &last)) && !previousLine(data, tail, terminator, &last)) {
+            last = first;
+        }
+        return extractRoot(top, last);
+    }
+    return extractRoot(top, first);
+}
+
+Folder*
+ListingImport::readLines(QIODevice *device)
+{
+    TreeBuilder builder;
+    QByteArray buffer;
+    QByteArray first; //the folder find was given, du lists it last
+    QByteArray last;
+    char terminator = 0;
+    bool du = false;
+    qint64 used = 0;
+    quint64 reportedFiles = 0;
+    FileSize reportedBytes = 0;
+
+    bool atEnd = false;
+    while (!atEnd && !m_parent->m_abort.loadAcquire()) {
+        buffer.resize(int(used) + BlockSize);
+        const qint64 read = device->read(buffer.data() + used, BlockSize);
+        atEnd = read <= 0;
+        const qint64 size = used + qMax<qint64>(read, 0);
+        const char *data = buffer.constData();
+        const char *end = data + size;
+        if (!terminator) {
+            terminator = memchr(data, '\0', size_t(size)) ? '\0' : '\n';
+        }
+
+        const char *p = data;
+        Line line;
+        line.path = nullptr;
+        forever {
+            const char *lineEnd = static_cast<const char*>(memchr(p, terminator, size_t(end - p)));
+            if (!lineEnd) {
+                if (!atEnd || p == end) {
+                    break;
+                }
+                lineEnd = end; //the last line need not be terminated
+            }
+            if (lineEnd > p) {
+                Line current;
+                if (parseLine(p, lineEnd, &current)) {
+                    if (first.isNull()) {
+                        first = QByteArray(current.path, current.length);
+                        du = current.path[-1] == '\t';
+                    }
+                    builder.add(current);
+                    line = current;
+                } else {
+                    ++builder.malformed;
+                }
+            }
+            p = lineEnd + 1;
+            if (p > end) {
+                p = end;
+            }
+        }
+        if (du && line.path) {
+            last = QByteArray(line.path, line.length);
+        }
+
+        //keep the unfinished line for the next block
+        used = end - p;
+        memmove(buffer.data(), p, size_t(used));
+
+        m_parent->m_telemetry.add(0, ScanTelemetry::Files, builder.files - reportedFiles);
+        m_parent->m_telemetry.add(0, ScanTelemetry::Bytes, builder.bytes - reportedBytes);
+        reportedFiles = builder.files;
+        reportedBytes = builder.bytes;
+    }
+
+    m_malformed += builder.malformed;
+    Folder *top = builder.finish();
+    if (first.isNull()) {
+        Folder::deleteTree(top);
+        return nullptr;
+    }
+    const QByteArray &rootPath = du ? last : first;
+    return extractRoot(top, { rootPath.constData(), rootPath.size(), 0 });
+}
+
+Folder*
+ListingImport::readNcdu(const char *data, qint64 size, QIODevice *device)
+{
+    NcduReader reader(data, size, device);
+    Folder *tree = reader.read(&m_parent->m_abort, &m_parent->m_telemetry);
+    if (!tree && !m_parent->m_abort.loadAcquire()) {
+        qCDebug(FILELIGHT_LOG) << "The ncdu export" << m_fileName << "is broken or cut short";
+        ++m_malformed;
+    }
+    return tree;
+}
+
+}
@@ -0,0 +1,84 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef LISTINGIMPORT_H
+#define LISTINGIMPORT_H
+
+#include <QString>
+#include <QThread>
+
+class Folder;
+class QIODevice;
+
+namespace Filelight
+{
+class ScanContext;
+
+/**
+ * Builds a tree from a listing made on another machine, so a server can be
+ * scanned where it is and mapped on a workstation. Reads the output of
+ * du -a -0 -B1, of find -printf '%s %p\0' (or either with newlines) and
+ * ncdu JSON exports.
+ *
+ * du and find list depth first, so the folders open along the path of the
+ * last line are all that has to be kept while the tree grows. A listing that
+ * is a regular file is mapped and cut at line ends into parts that are
+ * parsed in parallel, each part carrying on from the folders the line before
+ * it leaves open, and then joined in order. Anything else, a pipe say, is
+ * read a block at a time. ncdu exports nest, they are always read in one go.
+ *
+ * du and find do not tell empty folders from files, those show as files.
+ */
+class ListingImport : public QThread
+{
+    Q_OBJECT
+
+public:
+    /// Reads the listing @p fileName, "-" for the standard input.
+    ListingImport(const QString &fileName, ScanContext *parent);
+
+    /// Gives each thread at least @p bytes of a mapped listing rather than
+    /// 16 MiB, for the autotests to read small listings in many parts.
+    void setPartSize(qint64 bytes) {
+        m_partSize = qMax<qint64>(bytes, 1);
+    }
+
+Q_SIGNALS:
+    /// The tree read, named by the full path of its root on the machine
+    /// listed. 0 if nothing could be read.
+    void branchCompleted(Folder* tree);
+
+protected:
+    void run() override;
+
+private:
+    Folder *readLines(const char *data, qint64 size);
+    Folder *readLines(QIODevice *device);
+    Folder *readNcdu(const char *data, qint64 size, QIODevice *device);
+
+    const QString m_fileName;
+    ScanContext *m_parent;
+    quint64 m_malformed; //lines that could not be read
+    qint64 m_partSize;
+};
+
+}
+
+#endif
@@ -22,17 +22,21 @@
 #include "localLister.h"
 
 #include "Config.h"
+#include "checkpoint.h"
 #include "fileTree.h"
-#include "scan.h"
+#include "nodeArena.h"
+#include "scanContext.h"
 #include "filelight_debug.h"
 
 #include <QStorageInfo>
+#include <QDateTime>
 #include <QElapsedTimer>
-#include <QGuiApplication> //postEvent()
 #include <QFile>
 #include <QByteArray>
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <string.h> //strerror()
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -41,60 +45,450 @@
 #include <mntent.h>
 #endif
 
+#ifdef Q_OS_LINUX
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h> //makedev()
+#endif
+
+#if defined(Q_OS_LINUX) && defined(STATX_TYPE)
+#define HAVE_STATX 1
+#endif
+
+#if defined(HAVE_STATX) && defined(HAVE_LINUX_IO_URING_H)
+#define HAVE_URING_STAT 1
+#include "uringStat.h"
+#endif
+
+#ifndef DT_UNKNOWN
+#define DT_UNKNOWN 0
+#define DT_DIR 4
+#define DT_REG 8
+#endif
+
 namespace Filelight
 {
-QStringList LocalLister::s_remoteMounts;
-QStringList LocalLister::s_localMounts;
+#ifdef HAVE_STATX
+// cleared once the kernel (or a seccomp filter) turns out to refuse statx
+static QAtomicInt s_haveStatx(1);
+#endif
+#ifdef HAVE_URING_STAT
+// likewise for io_uring and its IORING_OP_STATX
+static QAtomicInt s_haveUring(1);
+#endif
+
+/// How long before the start of a scan a folder has to have changed for a
+/// rescan to trust its change time, some filesystems only keep even seconds.
+static const qint64 RacyWindow = 2000000000; // ns
+
+/// st_ctime in ns since the epoch.
+static qint64
+changeTime(const struct stat &statbuf)
+{
+#ifdef Q_OS_LINUX
+    return qint64(statbuf.st_ctim.tv_sec) * 1000000000 + statbuf.st_ctim.tv_nsec;
+#else
+    return qint64(statbuf.st_ctime) * 1000000000;
+#endif
+}
+
+/// A folder waiting to be listed, or waiting for its subfolders to complete.
+struct DirTask
+{
+    DirTask(const QByteArray &name, const QByteArray &folderName, DirTask *parent, NodeArena *arena)
+            : name(name)
+            , folder(arena->newFolder(folderName.constData()))
+            , parent(parent)
+            , fd(-1)
+            , dirRefs(1)
+            , pending(1)
+            , treesBelow(false)
+            , inodeOrder(parent && parent->inodeOrder)
+            , relative(false)
+            , resumed(false)
+            , previous(nullptr)
+            , device(parent ? parent->device : 0)
+            , dontSync(parent && parent->dontSync) {}
 
-LocalLister::LocalLister(const QString &path, QList<Folder *> *cachedTrees, ScanManager *parent)
+    /// Only used to report errors and find cached trees, the scan itself
+    /// never needs full paths.
+    QByteArray path() const {
+        QByteArray path;
+        for (const DirTask *task = this; task; task = task->parent) {
+            path.prepend(task->folder->name8Bit());
+        }
+        return path;
+    }
+
+    QByteArray name; // opened relative to the parent, or a full path
+    Folder *folder;
+    DirTask *parent; // 0 for the folder the scan was started on
+
+    /// The open folder, kept open until all subfolders have been opened
+    /// relative to it. 1 while the folder is being listed plus one for every
+    /// subfolder that has not been opened yet.
+    int fd;
+    QAtomicInt dirRefs;
+
+    /// 1 while the folder is being listed plus one for every subfolder
+    /// that has not completed yet, whoever drops it to 0 assembles the folder
+    QAtomicInt pending;
+
+    QMutex mutex; // guards completed
+    QVector<Folder*> completed;
+
+    PathMatcher::State matchState; // the skip list rules still in play here
+    bool treesBelow; // a cached tree may be grafted somewhere below
+    bool inodeOrder; // list entries sorted by inode number
+    bool relative; // name is relative to the parent's fd, which we hold a reference on
+    bool resumed; // left out by an earlier, time limited scan
+    Folder *previous; // the folder in the tree of the last scan, when rescanning
+
+    quint64 device; // st_dev of the folder, a different one means a mount point
+
+    /// Don't make network and FUSE filesystems refresh attributes for us,
+    /// see AT_STATX_DONT_SYNC.
+    bool dontSync;
+};
+
+/// A folder entry held back to be listed in inode order.
+struct SortedEntry
+{
+    quint64 inode;
+    int name; // offset in ScanWorker::names
+    unsigned char type;
+
+    bool operator<(const SortedEntry &other) const {
+        return inode < other.inode;
+    }
+};
+
+class ScanWorker : public QThread
+{
+public:
+    ScanWorker(LocalLister *lister, int index)
+            : statsAvoided(0)
+            , inodeOrdered(0)
+            , reused(0)
+#ifdef HAVE_URING_STAT
+            , ring(nullptr)
+            , ringBroken(false)
+#endif
+            , m_lister(lister)
+            , m_index(index) {}
+
+    ~ScanWorker() override {
+#ifdef HAVE_URING_STAT
+        delete ring;
+#endif
+    }
+
+    int index() const {
+        return m_index;
+    }
+
+    void push(DirTask *task) {
+        QMutexLocker locker(&m_mutex);
+        m_tasks.append(task);
+    }
+
+    /// The owner works depth first, this keeps the queues and the amount of
+    /// folders in flight small. Time limited scans go breadth first instead,
+    /// so what is left out when time runs out are the deepest folders.
+    DirTask *pop() {
+        QMutexLocker locker(&m_mutex);
+        if (m_tasks.isEmpty()) {
+            return nullptr;
+        }
+        return m_lister->m_timeLimited ? m_tasks.takeFirst() : m_tasks.takeLast();
+    }
+
+    /// Thieves take the oldest tasks, those are closest to the root and thus
+    /// likely to be large subtrees.
+    DirTask *steal() {
+        QMutexLocker locker(&m_mutex);
+        return m_tasks.isEmpty() ? nullptr : m_tasks.takeFirst();
+    }
+
+    quint64 statsAvoided; // entries classified by their d_type alone
+    quint64 inodeOrdered; // folders listed in inode order
+    quint64 reused; // folders whose files were taken from the last scan
+
+    NodeArena arena; // what the folders it finds and the files it lists are made of
+    QVector<SortedEntry> entries; // for folders listed in inode order
+    QByteArray names;
+
+    enum { BufferSize = 64 * 1024 };
+    alignas(8) char buffer[BufferSize]; // for DirReader
+
+#ifdef HAVE_URING_STAT
+    UringStat *ring; // created on first use
+    bool ringBroken; // a batch failed, don't trust the ring anymore
+#endif
+
+protected:
+    void run() override {
+        m_lister->work(this);
+    }
+
+private:
+    LocalLister *m_lister;
+    const int m_index;
+    QMutex m_mutex;
+    QList<DirTask*> m_tasks;
+};
+
+LocalLister::LocalLister(const QString &path, QHash<QByteArray, Folder*> *cachedTrees, ScanContext *parent)
         : QThread()
         , m_path(path)
         , m_trees(cachedTrees)
         , m_parent(parent)
+        , m_tree(nullptr)
+#ifdef HAVE_STATX
+        , m_statxMask(STATX_TYPE | STATX_BLOCKS | STATX_SIZE)
+#else
+        , m_statxMask(0)
+#endif
+        , m_countLinksOnce(Config::countHardlinksOnce)
+        , m_crossMounts(Config::scanAcrossMounts)
+        , m_crossRemoteMounts(Config::scanRemoteMounts)
+        , m_inodeOrder(Config::inodeOrder)
+        , m_timeLimited(Config::scanTimeBudget > 0)
+        , m_previous(nullptr)
+        , m_started(0)
+        , m_checkpoint(nullptr)
+        , m_matcher(Config::skipList)
 {
-    //add empty directories for any mount points that are in the path
-    //TODO empty directories is not ideal as adds to fileCount incorrectly
-
-    QStringList list(Config::skipList);
-    if (!Config::scanAcrossMounts) list += s_localMounts;
-    if (!Config::scanRemoteMounts) list += s_remoteMounts;
-
-    for (const QString &ignorePath : qAsConst(list)) {
-        if (ignorePath.startsWith(path)) {
-            QString folderName = ignorePath;
-            if (!folderName.endsWith(QLatin1Char('/'))) {
-                folderName += QLatin1Char('/');
+#ifdef HAVE_STATX
+    if (m_countLinksOnce) {
+        m_statxMask |= STATX_NLINK | STATX_INO;
+    }
+#endif
+
+    //note every folder between the scan root and a cached tree, only below
+    //those do we have to look for trees to graft
+    for (auto it = m_trees->constBegin(); it != m_trees->constEnd(); ++it) {
+        const QByteArray &treePath = it.key();
+        for (int i = treePath.lastIndexOf('/', treePath.size() - 2); i >= 0; i = treePath.lastIndexOf('/', i - 1)) {
+            m_treeParents.insert(treePath.left(i + 1));
+            if (i == 0) {
+                break;
             }
-            m_trees->append(new Folder(folderName.toLocal8Bit().constData()));
         }
     }
+
+    m_treeCount.storeRelease(m_trees->size());
+}
+
+LocalLister::LocalLister(const QVector<QByteArray> &folders, ScanContext *parent)
+        : LocalLister(QString(), new QHash<QByteArray, Folder*>, parent)
+{
+    m_resumed = folders;
+}
+
+LocalLister::LocalLister(Folder *previous, ScanContext *parent)
+        : LocalLister(previous->decodedName(), new QHash<QByteArray, Folder*>, parent)
+{
+    m_previous = previous;
 }
 
 void
 LocalLister::run()
 {
+    static_assert(int(MaxWorkers) <= int(ScanTelemetry::MaxWriters), "every worker needs a telemetry slot");
+
     QElapsedTimer timer;
     timer.start();
-    //recursively scan the requested path
-    const QByteArray path = QFile::encodeName(m_path);
-    Folder *tree = scan(path, path);
-    qCDebug(FILELIGHT_LOG) << "Scan completed in" << (timer.elapsed()/1000);
+    m_deadline = m_timeLimited ? QDeadlineTimer(qint64(Config::scanTimeBudget) * 1000) : QDeadlineTimer(QDeadlineTimer::Forever);
+    m_started = QDateTime::currentMSecsSinceEpoch() * 1000000;
+
+    const int threads = qBound(1, Config::scanThreads ? int(Config::scanThreads) : QThread::idealThreadCount(), int(MaxWorkers));
+    for (int i = 0; i < threads; ++i) {
+        m_workers.append(new ScanWorker(this, i));
+    }
+
+    //recursively scan the requested path, this thread is worker 0
+    if (m_resumed.isEmpty()) {
+        const QByteArray path = QFile::encodeName(m_path);
+        DirTask *root = new DirTask(path, path, nullptr, &m_workers.first()->arena);
+        root->matchState = m_matcher.start(path);
+        root->treesBelow = !m_trees->isEmpty();
+        root->previous = m_previous;
+        if (Config::checkpointInterval && !m_timeLimited) {
+            m_checkpoint = new Checkpoint(path);
+            m_checkpoint->started(root->folder, nullptr);
+            m_checkpoint->start();
+        }
+        push(m_workers.first(), root);
+    } else {
+        //the folders are collected by a root that is not listed itself
+        DirTask *root = new DirTask(QByteArray(), QByteArray(), nullptr, &m_workers.first()->arena);
+        for (const QByteArray &path : qAsConst(m_resumed)) {
+            DirTask *task = new DirTask(path, path, root, &m_workers.first()->arena);
+            task->resumed = true;
+            task->matchState = m_matcher.start(path);
+
+            //the folder holding it tells whether it is a mount point
+            struct stat statbuf;
+            const QByteArray parentPath = path.left(path.lastIndexOf('/', path.size() - 2) + 1);
+            if (stat(parentPath.constData(), &statbuf) == 0) {
+                task->device = statbuf.st_dev;
+            }
+
+            root->pending.ref();
+            push(m_workers.first(), task);
+        }
+        if (!root->pending.deref()) {
+            finish(root);
+        }
+    }
+
+    for (int i = 1; i < threads; ++i) {
+        m_workers[i]->start();
+    }
+    work(m_workers.first());
+    //the tree is made of what every worker allocated
+    NodeArena *arena = new NodeArena;
+    quint64 statsAvoided = 0, inodeOrdered = 0, reused = 0;
+    for (int i = 0; i < threads; ++i) {
+        m_workers[i]->wait();
+        statsAvoided += m_workers[i]->statsAvoided;
+        inodeOrdered += m_workers[i]->inodeOrdered;
+        reused += m_workers[i]->reused;
+        arena->adopt(&m_workers[i]->arena);
+    }
+    qDeleteAll(m_workers);
+    m_workers.clear();
+
+    //a completed scan needs no checkpoint, an aborted one may be continued
+    if (m_checkpoint) {
+        m_checkpoint->stop(m_parent->m_abort.loadAcquire());
+        delete m_checkpoint;
+        m_checkpoint = nullptr;
+    }
+
+    Folder *tree = m_tree;
+    const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    const ScanTelemetry::Snapshot totals = m_parent->m_telemetry.snapshot();
+    qCDebug(FILELIGHT_LOG) << "Scan completed in" << (elapsed/1000) << "seconds using" << threads << "threads,"
+                           << (totals[ScanTelemetry::Files] * 1000 / elapsed) << "files/s,"
+                           << (totals[ScanTelemetry::Bytes] / 1000 / elapsed) << "MB/s,"
+                           << totals[ScanTelemetry::StatCalls] << "stat calls," << statsAvoided << "avoided thanks to d_type,"
+                           << m_inodes.count() << "hard linked files,"
+                           << inodeOrdered << "folders listed in inode order,"
+                           << reused << "folders unchanged since the last scan,"
+#ifdef HAVE_STATX
+                           << "using" << ((Config::useStatx && s_haveStatx.loadAcquire()) ? "statx()" : "fstatat()");
+#else
+                           << "using fstatat()";
+#endif
+    for (const auto &error : m_parent->m_telemetry.errors()) {
+        qCDebug(FILELIGHT_LOG) << error.second << "times:" << strerror(error.first);
+    }
+    m_parent->m_errors.finish();
+    m_inodes.clear();
 
-    //delete the list of trees useful for this scan,
-    //in a successful scan the contents would now be transferred to 'tree'
+    //delete the list of trees useful for this scan, those grafted are
+    //part of 'tree' by now, the rest did not come up
+    for (Folder *folder : qAsConst(*m_trees)) {
+        Folder::deleteTree(folder);
+    }
     delete m_trees;
 
-    if (m_parent->m_abort) //scan was cancelled
+    //its unchanged files were copied, nothing of the last scan's tree is needed anymore
+    if (m_previous) {
+        Folder::deleteTree(m_previous);
+        m_previous = nullptr;
+    }
+
+    if (m_parent->m_abort.loadAcquire()) //scan was cancelled
     {
         qCDebug(FILELIGHT_LOG) << "Scan successfully aborted";
-        delete tree;
         tree = nullptr;
     }
+    if (tree) {
+        tree->setArena(arena);
+    } else {
+        //whatever an aborted scan got to
+        delete arena;
+    }
+
     qCDebug(FILELIGHT_LOG) << "Emitting signal to cache results ...";
     emit branchCompleted(tree);
     qCDebug(FILELIGHT_LOG) << "Thread terminating ...";
 }
 
+void
+LocalLister::work(ScanWorker *worker)
+{
+    forever {
+        DirTask *task = worker->pop();
+        if (!task) {
+            task = steal(worker);
+        }
+
+        if (task) {
+            scan(task, worker);
+
+            if (!m_outstanding.deref()) {
+                //that was the last folder, let the idle workers exit
+                QMutexLocker locker(&m_idleMutex);
+                m_idle.wakeAll();
+                break;
+            }
+            continue;
+        }
+
+        QMutexLocker locker(&m_idleMutex);
+        if (m_outstanding.loadAcquire() == 0) {
+            break;
+        }
+        //the timeout covers a push racing with us going to sleep
+        m_sleepers.ref();
+        m_idle.wait(&m_idleMutex, 10);
+        m_sleepers.deref();
+    }
+}
+
+void
+LocalLister::push(ScanWorker *worker, DirTask *task)
+{
+    m_outstanding.ref();
+    worker->push(task);
+
+    if (m_sleepers.loadAcquire() > 0) {
+        QMutexLocker locker(&m_idleMutex);
+        m_idle.wakeOne();
+    }
+}
+
+DirTask*
+LocalLister::steal(const ScanWorker *thief)
+{
+    const int count = m_workers.size();
+    for (int i = 1; i < count; ++i) {
+        if (DirTask *task = m_workers[(thief->index() + i) % count]->steal()) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+Folder*
+LocalLister::takeCachedTree(const QByteArray &path)
+{
+    if (m_treeCount.loadAcquire() == 0) {
+        return nullptr;
+    }
+
+    QMutexLocker locker(&m_treesMutex);
+    Folder *folder = m_trees->take(path);
+    if (folder) {
+        m_treeCount.storeRelease(m_trees->size());
+    }
+    return folder;
+}
+
 #ifndef S_BLKSIZE
 #define S_BLKSIZE 512
 #endif
@@ -102,158 +496,741 @@ LocalLister::run()
 
 #include <errno.h>
 static void
-outputError(const QByteArray &path)
+releaseDir(DirTask *task)
+{
+    if (task && !task->dirRefs.deref() && task->fd != -1) {
+        close(task->fd);
+        task->fd = -1;
+    }
+}
+
+static int
+openDir(const DirTask *task)
+{
+    //O_NOFOLLOW as a folder may have been replaced by a symlink since it was listed
+    const int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+    return task->relative ? openat(task->parent->fd, task->name.constData(), flags)
+                          : open(task->name.constData(), flags);
+}
+
+LocalLister::FilesystemKind
+LocalLister::classifyFilesystem(int fd, const QByteArray &path)
+{
+#ifdef Q_OS_LINUX
+    Q_UNUSED(path)
+    struct statfs fs;
+    if (fstatfs(fd, &fs) == -1) {
+        return LocalLister::OrdinaryFilesystem;
+    }
+
+    switch (static_cast<quint32>(fs.f_type)) {
+    case 0x6969:        // NFS_SUPER_MAGIC
+    case 0x517B:        // SMB_SUPER_MAGIC
+    case 0xFF534D42:    // CIFS_MAGIC_NUMBER
+    case 0xFE534D42:    // SMB2_MAGIC_NUMBER
+    case 0x5346414F:    // AFS_SUPER_MAGIC
+    case 0x00C36400:    // CEPH_SUPER_MAGIC
+    case 0x01021997:    // V9FS_MAGIC
+    case 0x65735546:    // FUSE_SUPER_MAGIC
+        return LocalLister::RemoteFilesystem;
+    case 0x9FA0:        // PROC_SUPER_MAGIC
+    case 0x62656572:    // SYSFS_MAGIC
+    case 0x27E0EB:      // CGROUP_SUPER_MAGIC
+    case 0x63677270:    // CGROUP2_SUPER_MAGIC
+    case 0x64626720:    // DEBUGFS_MAGIC
+    case 0x74726163:    // TRACEFS_MAGIC
+    case 0x73636673:    // SECURITYFS_MAGIC
+    case 0x1CD1:        // DEVPTS_SUPER_MAGIC
+    case 0x6165676C:    // PSTOREFS_MAGIC
+    case 0xCAFE4A11:    // BPF_FS_MAGIC
+    case 0xDE5E81E4:    // EFIVARFS_MAGIC
+    case 0x62656570:    // CONFIGFS_MAGIC
+    case 0xF97CFF8C:    // SELINUX_MAGIC
+    case 0x42494E4D:    // BINFMTFS_MAGIC
+    case 0x65735543:    // FUSE_CTL_SUPER_MAGIC
+    case 0x19800202:    // MQUEUE_MAGIC
+    case 0x6E736673:    // NSFS_MAGIC
+        return LocalLister::PseudoFilesystem;
+    }
+#else
+    static const QSet<QByteArray> remoteFsTypes = { "smbfs", "nfs", "afs" };
+    static const QSet<QByteArray> pseudoFsTypes = { "procfs", "devfs", "fdescfs" };
+
+    Q_UNUSED(fd)
+    const QByteArray type = QStorageInfo(QFile::decodeName(path)).fileSystemType();
+    if (remoteFsTypes.contains(type)) {
+        return LocalLister::RemoteFilesystem;
+    }
+    if (pseudoFsTypes.contains(type)) {
+        return LocalLister::PseudoFilesystem;
+    }
+#endif
+    return LocalLister::OrdinaryFilesystem;
+}
+
+/// True if the block device @p device sits on spins, as far as the kernel knows.
+static bool
+isRotational(quint64 device)
+{
+#ifdef Q_OS_LINUX
+    //partitions have no queue of their own, their disk is one level up
+    const QByteArray base = "/sys/dev/block/" + QByteArray::number(major(device)) + ':' + QByteArray::number(minor(device));
+    for (const char *queue : { "/queue/rotational", "/../queue/rotational" }) {
+        const int fd = open((base + queue).constData(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            continue;
+        }
+        char flag = '0';
+        const bool ok = read(fd, &flag, 1) == 1;
+        close(fd);
+        if (ok) {
+            return flag == '1';
+        }
+    }
+#else
+    Q_UNUSED(device)
+#endif
+    return false;
+}
+
+/// The part of an entry's metadata the scan looks at.
+struct EntryStat
+{
+    mode_t mode;
+    quint64 blocks; // in units of S_BLKSIZE
+    quint64 size;
+    quint64 nlink;
+    quint64 device;
+    quint64 inode;
+};
+
+#ifdef HAVE_STATX
+static int
+statxFlags(bool dontSync)
+{
+    return AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | (dontSync ? AT_STATX_DONT_SYNC : AT_STATX_SYNC_AS_STAT);
+}
+
+static void
+fromStatx(const struct statx &stx, EntryStat *entry)
+{
+    entry->mode = stx.stx_mode;
+    entry->blocks = stx.stx_blocks;
+    entry->size = stx.stx_size;
+    entry->nlink = stx.stx_nlink;
+    entry->device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    entry->inode = stx.stx_ino;
+}
+#endif
+
+/**
+ * Fetches the metadata of @p name in the folder @p fd, without following
+ * symlinks. Uses statx where available, as that lets us ask for just the
+ * fields in @p statxMask, and fstatat otherwise.
+ */
+static bool
+statEntry(int fd, const char *name, uint statxMask, bool dontSync, EntryStat *entry)
 {
-    ///show error message that stat or opendir may give
-
-#define out(s) qWarning() << s ": " << path; break
-
-    switch (errno) {
-    case EACCES:
-        out("Inadequate access permissions");
-    case EMFILE:
-        out("Too many file descriptors in use by Filelight");
-    case ENFILE:
-        out("Too many files are currently open in the system");
-    case ENOENT:
-        out("A component of the path does not exist, or the path is an empty string");
-    case ENOMEM:
-        out("Insufficient memory to complete the operation");
-    case ENOTDIR:
-        out("A component of the path is not a folder");
-    case EBADF:
-        out("Bad file descriptor");
-    case EFAULT:
-        out("Bad address");
+#ifdef HAVE_STATX
+    if (Config::useStatx && s_haveStatx.loadAcquire()) {
+        struct statx stx;
+        if (statx(fd, name, statxFlags(dontSync), statxMask, &stx) == 0) {
+            fromStatx(stx, entry);
+            return true;
+        }
+        if (errno != ENOSYS && errno != EPERM) {
+            return false;
+        }
+        s_haveStatx.storeRelease(0);
+        qCDebug(FILELIGHT_LOG) << "statx() is not available, falling back to fstatat()";
+    }
+#else
+    Q_UNUSED(statxMask)
+    Q_UNUSED(dontSync)
+#endif
+
+    struct stat statbuf;
+    if (fstatat(fd, name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1) {
+        return false;
+    }
+    entry->mode = statbuf.st_mode;
 #ifndef Q_OS_WIN
-    case ELOOP: //NOTE shouldn't ever happen
-        out("Too many symbolic links encountered while traversing the path");
+    entry->blocks = statbuf.st_blocks;
+#else
+    entry->blocks = 0;
+#endif
+    entry->size = statbuf.st_size;
+    entry->nlink = statbuf.st_nlink;
+    entry->device = statbuf.st_dev;
+    entry->inode = statbuf.st_ino;
+    return true;
+}
+
+/**
+ * Reads the entries of an open folder together with their d_type.
+ *
+ * On Linux the entries are fetched straight from the kernel with
+ * getdents64, a whole buffer at a time, elsewhere we go through readdir.
+ */
+class DirReader
+{
+public:
+    DirReader(int fd, char *buffer, int size)
+            : m_error(0)
+#ifdef Q_OS_LINUX
+            , m_fd(fd)
+            , m_buffer(buffer)
+            , m_size(size)
+            , m_length(0)
+            , m_position(0)
+#endif
+    {
+#ifndef Q_OS_LINUX
+        Q_UNUSED(buffer)
+        Q_UNUSED(size)
+        //readdir takes ownership of the descriptor, which we still need
+        const int copy = dup(fd);
+        m_dir = copy == -1 ? nullptr : fdopendir(copy);
+        if (!m_dir) {
+            m_error = errno;
+            if (copy != -1) {
+                close(copy);
+            }
+        }
+#endif
+    }
+
+    ~DirReader() {
+#ifndef Q_OS_LINUX
+        if (m_dir) {
+            closedir(m_dir);
+        }
 #endif
-    case ENAMETOOLONG:
-        out("File name too long");
     }
 
-#undef out
+    /// @return false once all entries were read, or on error
+    bool next(const char **name, unsigned char *type, quint64 *inode)
+    {
+#ifdef Q_OS_LINUX
+        // getdents64 has only been wrapped by glibc since 2.30
+        struct KernelDirent {
+            quint64 d_ino;
+            qint64 d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+
+        if (m_position >= m_length) {
+            const long length = syscall(SYS_getdents64, m_fd, m_buffer, m_size);
+            if (length <= 0) {
+                m_error = length < 0 ? errno : 0;
+                return false;
+            }
+            m_length = length;
+            m_position = 0;
+        }
+
+        const KernelDirent *ent = reinterpret_cast<const KernelDirent*>(m_buffer + m_position);
+        m_position += ent->d_reclen;
+        *name = ent->d_name;
+        *type = ent->d_type;
+        *inode = ent->d_ino;
+        return true;
+#else
+        if (!m_dir) {
+            return false;
+        }
+
+        errno = 0;
+        const dirent *ent = readdir(m_dir);
+        if (!ent) {
+            m_error = errno;
+            return false;
+        }
+        *name = ent->d_name;
+        *inode = ent->d_ino;
+#if defined(_DIRENT_HAVE_D_TYPE) || defined(DTTOIF)
+        *type = ent->d_type;
+#else
+        *type = DT_UNKNOWN;
+#endif
+        return true;
+#endif
+    }
+
+    /// errno of a failed read, 0 if all went well
+    int error() const {
+        return m_error;
+    }
+
+private:
+    int m_error;
+#ifdef Q_OS_LINUX
+    const int m_fd;
+    char *m_buffer;
+    const int m_size;
+    long m_length;
+    long m_position;
+#else
+    DIR *m_dir;
+#endif
+};
+
+#ifdef HAVE_URING_STAT
+/// @return the worker's io_uring if files in @p task should be stat'ed in batches
+static UringStat*
+batchRing(const DirTask *task, ScanWorker *worker)
+{
+    //on local disks the synchronous path is faster, the kernel has to hand
+    //uring statx calls to its worker threads
+    if (Config::ioUringScan == Config::IoUringNever ||
+            (Config::ioUringScan == Config::IoUringRemote && !task->dontSync) ||
+            !s_haveStatx.loadAcquire() || !Config::useStatx ||
+            worker->ringBroken) {
+        return nullptr;
+    }
+
+    if (!worker->ring && s_haveUring.loadAcquire()) {
+        worker->ring = UringStat::create(256);
+        if (!worker->ring) {
+            s_haveUring.storeRelease(0);
+        }
+    }
+    return worker->ring;
 }
+#endif
 
-Folder*
-LocalLister::scan(const QByteArray &path, const QByteArray &dirname)
+LocalLister::Filesystem
+LocalLister::filesystem(const DirTask *task)
 {
-    Folder *cwd = new Folder(dirname.constData());
-    DIR *dir = opendir(path.constData());
+    QMutexLocker locker(&m_filesystemsMutex);
+    const auto it = m_filesystems.constFind(task->device);
+    if (it != m_filesystems.constEnd()) {
+        return it.value();
+    }
+
+    Filesystem fs;
+    fs.kind = classifyFilesystem(task->fd, task->path());
+    fs.rotational = fs.kind == OrdinaryFilesystem && isRotational(task->device);
+    m_filesystems.insert(task->device, fs);
+    return fs;
+}
 
-    if (!dir) {
-        outputError(path);
-        return cwd;
+bool
+LocalLister::isMountRoot(int fd, const QByteArray &path, MountTable *mounts)
+{
+#if defined(HAVE_STATX) && defined(STATX_ATTR_MOUNT_ROOT)
+    //Linux 5.8 and later tell
+    if (Config::useStatx && s_haveStatx.loadAcquire()) {
+        struct statx stx;
+        if (statx(fd, "", AT_EMPTY_PATH | AT_NO_AUTOMOUNT, 0, &stx) == 0 && (stx.stx_attributes_mask & STATX_ATTR_MOUNT_ROOT)) {
+            return stx.stx_attributes & STATX_ATTR_MOUNT_ROOT;
+        }
     }
+#endif
 
-#ifdef _MSC_VER
-//use a wider struct on win for nice handling of files larger than 2 GB
-#undef KDE_struct_stat
-#undef KDE_lstat
-#define KDE_struct_stat struct _stat64
-#define KDE_lstat kdewin32_stat64
+#ifdef Q_OS_LINUX
+    QMutexLocker locker(&mounts->mutex);
+    if (!mounts->read) {
+        for (const QStorageInfo &volume : QStorageInfo::mountedVolumes()) {
+            QByteArray root = QFile::encodeName(volume.rootPath());
+            if (!root.endsWith('/')) {
+                root += '/';
+            }
+            mounts->paths.insert(root);
+        }
+        mounts->read = true;
+    }
+    return mounts->paths.contains(path);
+#else
+    //only Linux has subvolumes with a device of their own
+    Q_UNUSED(fd)
+    Q_UNUSED(path)
+    Q_UNUSED(mounts)
+    return true;
 #endif
+}
 
+bool
+LocalLister::enterFilesystem(DirTask *task)
+{
     struct stat statbuf;
-    dirent *ent;
-    while ((ent = readdir(dir)))
-    {
-        if (m_parent->m_abort)
-        {
-            closedir(dir);
-            return cwd;
+    if (fstat(task->fd, &statbuf) == -1) {
+        return true;
+    }
+
+    //only mount points need a closer look, everything else stays on the
+    //filesystem of the parent, whose device the task started out with
+    const bool mountPoint = task->device != quint64(statbuf.st_dev) && (!task->parent || isMountRoot(task->fd, task->path(), &m_mounts));
+    task->device = statbuf.st_dev;
+
+    //a rescan lists the folder again once its change time moved on, the
+    //timestamps are too coarse to tell about changes right at the start
+    //of this scan though, those folders are always listed again
+    const qint64 changed = changeTime(statbuf);
+    task->folder->setChangeTime(changed < m_started - RacyWindow ? changed : 0);
+
+    if (!mountPoint && !task->resumed) {
+        return true;
+    }
+
+    const Filesystem fs = filesystem(task);
+    const FilesystemKind kind = fs.kind;
+    task->dontSync = kind == RemoteFilesystem;
+    task->inodeOrder = m_inodeOrder == Config::InodeOrderAlways ||
+                       (m_inodeOrder == Config::InodeOrderRotational && fs.rotational);
+
+    if (!task->parent || !mountPoint) {
+        //always scan what was asked for
+        return true;
+    }
+
+    switch (kind) {
+    case PseudoFilesystem:
+        return false;
+    case RemoteFilesystem:
+        return m_crossMounts && m_crossRemoteMounts;
+    case OrdinaryFilesystem:
+        break;
+    }
+    return m_crossMounts;
+}
+
+void
+LocalLister::scan(DirTask *task, ScanWorker *worker)
+{
+    Folder *cwd = task->folder;
+
+    //once out of time the folders left stay empty, ScanManager guesses their size
+    const bool expired = m_timeLimited && task->parent && !task->resumed && m_deadline.hasExpired();
+
+    //once aborted we still assemble the queued folders, just without listing them
+    if (expired && task->previous && !task->previous->isEstimated()) {
+        //a rescan out of time keeps what the last one found here, better than a guess
+        cwd->setChangeTime(task->previous->changeTime());
+        cwd->copyTree(&worker->arena, task->previous);
+        m_parent->m_telemetry.add(worker->index(), ScanTelemetry::Files, cwd->children());
+        m_parent->m_telemetry.add(worker->index(), ScanTelemetry::Bytes, cwd->allocatedSize());
+    } else if (expired) {
+        cwd->setEstimated();
+    } else if (!m_parent->m_abort.loadAcquire()) {
+        task->fd = openDir(task);
+        if (task->fd == -1) {
+            m_parent->m_telemetry.addError(worker->index(), errno);
+            m_parent->m_errors.addFolder(task->path(), errno);
+        } else if (!enterFilesystem(task)) {
+            //a mount point we don't descend into, it shows as an empty folder
+            close(task->fd);
+            task->fd = -1;
         }
+    }
+    if (task->relative) {
+        releaseDir(task->parent);
+    }
 
-        if (qstrcmp(ent->d_name, ".") == 0 || qstrcmp(ent->d_name, "..") == 0)
-            continue;
+    const int fd = task->fd;
+    if (fd == -1) {
+        releaseDir(task);
+        if (!task->pending.deref()) {
+            finish(task);
+        }
+        return;
+    }
+
+    //full paths are only needed on the way to cached trees left to graft, and
+    //by time limited scans, which open folders by path so that the many
+    //folders queued breadth first don't keep their parents open
+    const bool grafting = task->treesBelow && m_treeCount.loadAcquire();
+    const QByteArray path = (grafting || m_timeLimited) ? task->path() : QByteArray();
+
+    ScanTelemetry &telemetry = m_parent->m_telemetry;
+    const int slot = worker->index();
+
+    //errors are tallied per folder and reported once it is done
+    QVector<QPair<int, uint>> failures;
+    auto entryFailed = [&](int error) {
+        telemetry.addError(slot, error);
+        for (QPair<int, uint> &failure : failures) {
+            if (failure.first == error) {
+                ++failure.second;
+                return;
+            }
+        }
+        failures.append(qMakePair(error, 1u));
+    };
+
+    //when rescanning, the subfolders the last scan found here
+    Folder *previous = task->previous;
+    QHash<QByteArray, Folder*> previousFolders;
+    if (previous && !previous->isEstimated()) {
+        for (File *file : qAsConst(previous->files)) {
+            if (file->isFolder()) {
+                previousFolders.insert(QByteArray(file->name8Bit()), static_cast<Folder*>(file));
+            }
+        }
+    }
+
+    auto addFolder = [&](const char *d_name) {
+        PathMatcher::State matchState;
+        if (m_matcher.excludesFolder(task->matchState, d_name, &matchState)) {
+            return;
+        }
 
         // QStringBuilder is used here. It assumes ent->d_name is char[NAME_MAX + 1],
         // and thus copies only first NAME_MAX + 1 chars.
         // Actually, while it's not fully POSIX-compatible, current behaviour may return d_name longer than NAME_MAX.
         // Make full copy of this string.
-        QByteArray new_path = path + static_cast<const char*>(ent->d_name);
-
-        //get file information
-        if (lstat(new_path.constData(), &statbuf) == -1) {
-            outputError(new_path);
-            continue;
-        }
+        const QByteArray name(d_name);
+        const QByteArray new_dirname = name + '/';
 
-        if (S_ISLNK(statbuf.st_mode) ||
-                S_ISCHR(statbuf.st_mode) ||
-                S_ISBLK(statbuf.st_mode) ||
-                S_ISFIFO(statbuf.st_mode)||
-                S_ISSOCK(statbuf.st_mode))
-        {
-            continue;
+        //check to see if we've scanned this section already
+        if (Folder *folder = grafting ? takeCachedTree(path + new_dirname) : nullptr) {
+            qCDebug(FILELIGHT_LOG) << "Tree pre-completed: " << folder->decodedName();
+            telemetry.add(slot, ScanTelemetry::Files, folder->children());
+            telemetry.add(slot, ScanTelemetry::Bytes, folder->allocatedSize());
+            cwd->append(folder, new_dirname.constData());
+            worker->arena.adopt(folder);
+            if (m_checkpoint) {
+                m_checkpoint->started(folder, cwd);
+                m_checkpoint->completed(folder);
+            }
+        } else {
+            //then scan, whichever worker gets to it first
+            task->pending.ref();
+            DirTask *child = new DirTask(m_timeLimited ? path + name : name, new_dirname, task, &worker->arena);
+            child->matchState = matchState;
+            child->treesBelow = grafting && m_treeParents.contains(path + new_dirname);
+            child->relative = !m_timeLimited;
+            child->previous = previousFolders.value(new_dirname);
+            if (child->relative) {
+                task->dirRefs.ref();
+            }
+            if (m_checkpoint) {
+                m_checkpoint->started(child->folder, cwd);
+            }
+            push(worker, child);
         }
+        telemetry.add(slot, ScanTelemetry::Folders);
+    };
 
-        if (S_ISREG(statbuf.st_mode)) //file
+    auto addEntry = [&](const char *d_name, const EntryStat &entry) {
+        if (S_ISREG(entry.mode)) { //file
+            if (m_matcher.excludesFile(task->matchState, d_name)) {
+                return;
+            }
 #ifndef Q_OS_WIN
-            cwd->append(ent->d_name, (statbuf.st_blocks * S_BLKSIZE));
+            FileSize size = entry.blocks * S_BLKSIZE;
 #else
-            cwd->append(ent->d_name, statbuf.st_size);
-#endif
-
-        else if (S_ISDIR(statbuf.st_mode)) //folder
-        {
-            Folder *d = nullptr;
-            const QByteArray new_dirname = QByteArray(ent->d_name) + QByteArrayLiteral("/");
-            new_path += '/';
-
-            //check to see if we've scanned this section already
-
-            for (Folder *folder : *m_trees)
-            {
-                if (new_path == folder->name8Bit())
-                {
-                    qCDebug(FILELIGHT_LOG) << "Tree pre-completed: " << folder->decodedName();
-                    d = folder;
-                    m_trees->removeAll(folder);
-                    m_parent->m_files += folder->children();
-                    cwd->append(folder, new_dirname.constData());
+            FileSize size = entry.size;
+#endif
+            FileSize apparentSize = entry.size;
+            //only the first link we come across is charged for the data
+            if (m_countLinksOnce && entry.nlink > 1 && !m_inodes.insert(entry.device, entry.inode)) {
+                size = apparentSize = 0;
+            }
+            cwd->append(&worker->arena, d_name, size, apparentSize);
+            telemetry.add(slot, ScanTelemetry::Files);
+            telemetry.add(slot, ScanTelemetry::Bytes, size);
+        } else if (S_ISDIR(entry.mode)) { //folder
+            addFolder(d_name);
+        }
+        //else symlinks, devices, fifos and sockets
+    };
+
+    EntryStat entry;
+
+#ifdef HAVE_URING_STAT
+    UringStat *ring = batchRing(task, worker);
+
+    auto flushRing = [&]() {
+        telemetry.add(slot, ScanTelemetry::StatCalls, ring->count());
+        const bool ran = ring->run(m_statxMask, statxFlags(task->dontSync));
+        for (int i = 0; i < ring->count(); ++i) {
+            if (!ran) {
+                //the ring broke down, do this batch the slow way
+                if (statEntry(fd, ring->name(i), m_statxMask, task->dontSync, &entry)) {
+                    addEntry(ring->name(i), entry);
+                } else {
+                    entryFailed(errno);
                 }
+            } else if (ring->error(i)) {
+                entryFailed(ring->error(i));
+            } else {
+                fromStatx(ring->stat(i), &entry);
+                addEntry(ring->name(i), entry);
             }
+        }
+        ring->clear();
+        if (!ran) {
+            worker->ringBroken = true;
+        }
+    };
+#endif
 
-            if (!d) //then scan
-                if ((d = scan(new_path, new_dirname))) //then scan was successful
-                    cwd->append(d);
+    auto listEntry = [&](const char *d_name, unsigned char d_type) {
+        //most filesystems tell us the type of the entry, then only files
+        //have to be stat'ed to get their size
+        if (d_type == DT_DIR) {
+            ++worker->statsAvoided;
+            addFolder(d_name);
+        } else if (d_type == DT_REG || d_type == DT_UNKNOWN) {
+#ifdef HAVE_URING_STAT
+            if (ring) {
+                ring->add(fd, d_name);
+                if (ring->isFull()) {
+                    flushRing();
+                }
+                return;
+            }
+#endif
+            //get file information, relative to the folder so the kernel does
+            //not have to resolve the full path again
+            telemetry.add(slot, ScanTelemetry::StatCalls);
+            if (statEntry(fd, d_name, m_statxMask, task->dontSync, &entry)) {
+                addEntry(d_name, entry);
+            } else {
+                entryFailed(errno);
+            }
+        } else {
+            //symlinks, devices, fifos and sockets
+            ++worker->statsAvoided;
+        }
+    };
+
+    //nothing was added, removed or renamed here since the last scan, so its
+    //files are taken over as they were and only the subfolders are visited
+    if (previous && !previous->isEstimated() && cwd->changeTime() && cwd->changeTime() == previous->changeTime()) {
+        ++worker->reused;
+        cwd->copyFiles(&worker->arena, previous);
+        telemetry.add(slot, ScanTelemetry::Files, cwd->children());
+        telemetry.add(slot, ScanTelemetry::Bytes, cwd->allocatedSize());
+        for (File *file : qAsConst(previous->files)) {
+            if (!file->isFolder()) {
+                continue;
+            }
+            QByteArray name(file->name8Bit());
+            name.chop(1);
+            addFolder(name.constData());
+        }
+
+        releaseDir(task);
+        if (!task->pending.deref()) {
+            finish(task);
+        }
+        return;
+    }
+
+    //on spinning disks inodes are best visited in the order they are stored,
+    //so the entries are collected and sorted by inode number first
+    const bool inodeOrder = task->inodeOrder;
+    worker->entries.clear();
+    worker->names.clear();
+
+    DirReader reader(fd, worker->buffer, ScanWorker::BufferSize);
+    const char *d_name;
+    unsigned char d_type;
+    quint64 d_ino;
+    while (reader.next(&d_name, &d_type, &d_ino))
+    {
+        if (m_parent->m_abort.loadAcquire())
+            break;
+
+        if (qstrcmp(d_name, ".") == 0 || qstrcmp(d_name, "..") == 0)
+            continue;
+
+        if (inodeOrder) {
+            worker->entries.append({d_ino, worker->names.size(), d_type});
+            worker->names.append(d_name, int(qstrlen(d_name)) + 1);
+        } else {
+            listEntry(d_name, d_type);
+        }
+    }
+
+    if (inodeOrder && !m_parent->m_abort.loadAcquire()) {
+        ++worker->inodeOrdered;
+        std::sort(worker->entries.begin(), worker->entries.end());
+
+        //files first, then the folders from the highest inode down, as the
+        //worker's queue hands out the last folder pushed first, unless the
+        //scan is time limited and goes breadth first
+        for (const SortedEntry &e : qAsConst(worker->entries)) {
+            if (e.type != DT_DIR) {
+                listEntry(worker->names.constData() + e.name, e.type);
+            }
+        }
+        const int count = worker->entries.size();
+        for (int i = 0; i < count; ++i) {
+            const SortedEntry &e = worker->entries.at(m_timeLimited ? i : count - 1 - i);
+            if (e.type == DT_DIR) {
+                listEntry(worker->names.constData() + e.name, e.type);
+            }
         }
+    }
 
-        ++m_parent->m_files;
+#ifdef HAVE_URING_STAT
+    if (ring && ring->count()) {
+        if (m_parent->m_abort.loadAcquire()) {
+            ring->clear();
+        } else {
+            flushRing();
+        }
     }
+#endif
 
-    closedir(dir);
+    if (reader.error()) {
+        telemetry.addError(slot, reader.error());
+        m_parent->m_errors.addFolder(task->path(), reader.error());
+    }
+    if (!failures.isEmpty()) {
+        const QByteArray folder = task->path();
+        for (const QPair<int, uint> &failure : qAsConst(failures)) {
+            m_parent->m_errors.addEntries(folder, failure.first, failure.second);
+        }
+    }
 
-    std::sort(cwd->files.begin(), cwd->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+    releaseDir(task);
 
-    return cwd;
+    if (!task->pending.deref()) {
+        finish(task);
+    }
 }
 
-void LocalLister::readMounts()
+void
+LocalLister::finish(DirTask *task)
 {
-    static const QSet<QByteArray> remoteFsTypes = { "smbfs", "nfs", "afs" };
+    //assemble the folder, then hand it to the parent, completing that too if
+    //this was the last subfolder it was waiting for
 
-    for (const QStorageInfo &storage : QStorageInfo::mountedVolumes()) {
-        if (storage.isRoot()) {
-            continue;
+    while (task) {
+        Folder *cwd = task->folder;
+        for (Folder *folder : qAsConst(task->completed)) {
+            cwd->append(folder);
         }
 
-        QString path = storage.rootPath();
-        if (!path.endsWith(QLatin1Char('/'))) {
-            path += QLatin1Char('/');
+        std::sort(cwd->files.begin(), cwd->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+
+        //folders cut short by an abort are listed again when continuing
+        if (m_checkpoint && !m_parent->m_abort.loadAcquire()) {
+            m_checkpoint->completed(cwd);
         }
 
-        if (remoteFsTypes.contains(storage.fileSystemType()) && !s_remoteMounts.contains(path)) {
-            s_remoteMounts.append(path);
-        } else if (!s_localMounts.contains(path)) {
-            s_localMounts.append(path);
+        DirTask *parent = task->parent;
+        if (parent) {
+            QMutexLocker locker(&parent->mutex);
+            parent->completed.append(cwd);
+            if (!parent->parent && m_resumed.isEmpty() && !m_parent->m_abort.loadAcquire()) {
+                //the GUI may walk up from it, finishing the root must not write to it then
+                parent->folder->link(cwd);
+                emit branchPublished(cwd);
+            }
+        } else {
+            m_tree = cwd;
         }
-    }
 
-    qCDebug(FILELIGHT_LOG) << "Found the following remote filesystems: " << s_remoteMounts;
-    qCDebug(FILELIGHT_LOG) << "Found the following local filesystems: " << s_localMounts;
+        delete task;
+        task = (parent && !parent->pending.deref()) ? parent : nullptr;
+    }
 }
 
 }//namespace Filelight
@@ -22,38 +22,130 @@
 #ifndef LOCALLISTER_H
 #define LOCALLISTER_H
 
+#include <QAtomicInt>
 #include <QByteArray>
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
 #include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "Config.h"
+#include "inodeSet.h"
+#include "pathMatcher.h"
 
 class Folder;
 
 namespace Filelight
 {
-class ScanManager;
+class Checkpoint;
+class ScanContext;
+class ScanWorker;
+struct DirTask;
 
+/**
+ * Scans a local folder with a pool of worker threads.
+ *
+ * Every folder is a task. Workers keep their own queue of tasks and steal
+ * from each other when they run dry, a folder is assembled and sorted once
+ * the last of its subfolders completes.
+ *
+ * With Config::scanTimeBudget set the scan goes breadth first and leaves the
+ * folders it has not got to by then unlisted, see Folder::isEstimated().
+ */
 class LocalLister : public QThread
 {
     Q_OBJECT
 
 public:
-    LocalLister(const QString &path, QList<Folder*> *cachedTrees, ScanManager *parent);
+    LocalLister(const QString &path, QHash<QByteArray, Folder*> *cachedTrees, ScanContext *parent);
+
+    /// Lists the folders a time limited scan left out, given by full path.
+    /// The tree completed is a nameless folder holding them under those paths.
+    LocalLister(const QVector<QByteArray> &folders, ScanContext *parent);
+
+    /// Scans the folder @p previous was scanned from again, only listing the
+    /// folders whose entries changed since. The lister takes @p previous over.
+    LocalLister(Folder *previous, ScanContext *parent);
+
+    enum { MaxWorkers = 64 };
+
+    enum FilesystemKind { OrdinaryFilesystem, RemoteFilesystem, PseudoFilesystem };
+
+    /// Sorts filesystems into those we scan as usual, those where fetching
+    /// attributes may cost a round trip and those that only pretend to hold
+    /// files. @p fd is the open folder @p path.
+    static FilesystemKind classifyFilesystem(int fd, const QByteArray &path);
 
-    static void readMounts();
+    /// The mount table, only read when statx() can't tell.
+    struct MountTable {
+        QSet<QByteArray> paths; // with a trailing '/'
+        bool read = false;
+        QMutex mutex; // guards the two above
+    };
+
+    /// Whether the open folder @p fd at @p path, on another device than its
+    /// parent, is where a filesystem is mounted. btrfs subvolumes and
+    /// snapshots have a device of their own without being mounted, they are
+    /// part of the parent.
+    static bool isMountRoot(int fd, const QByteArray &path, MountTable *mounts);
 
 Q_SIGNALS:
     void branchCompleted(Folder* tree);
+    /// A subfolder of the folder scanned is complete. It is still assembled
+    /// into the tree branchCompleted() hands over, but no longer changes.
+    void branchPublished(Folder* branch);
 
 private:
     QString m_path;
-    QList<Folder*> *m_trees;
-    ScanManager *m_parent;
+    QHash<QByteArray, Folder*> *m_trees; //by full path
+    QSet<QByteArray> m_treeParents; //the folders on the way to a cached tree
+    QAtomicInt m_treeCount; //lets workers skip m_treesMutex once every cached tree is grafted
+    QMutex m_treesMutex;
+    ScanContext *m_parent;
+    Folder *m_tree;
+    uint m_statxMask; //the fields statx() fetches for every file
+    bool m_countLinksOnce;
+    bool m_crossMounts;
+    bool m_crossRemoteMounts;
+    Config::InodeOrder m_inodeOrder;
+    const bool m_timeLimited;
+    QDeadlineTimer m_deadline;
+    QVector<QByteArray> m_resumed; //the folders to list when resuming a scan
+    Folder *m_previous; //the tree of the last scan when rescanning, deleted once done
+    qint64 m_started; //ns since the epoch, folders changed later are not trusted by the next rescan
+    Checkpoint *m_checkpoint; //keeps the progress on disk, 0 if it is not kept
 
-private:
-    void run() override;
-    Folder *scan(const QByteArray&, const QByteArray&);
+    struct Filesystem {
+        FilesystemKind kind;
+        bool rotational;
+    };
+    QHash<quint64, Filesystem> m_filesystems; //by st_dev, only looked up at mount points
+    QMutex m_filesystemsMutex; //guards the one above
+    MountTable m_mounts;
+    PathMatcher m_matcher; //Config::skipList
+    InodeSet m_inodes; //hard linked files already charged to the tree
+
+    QVector<ScanWorker*> m_workers;
+    QAtomicInt m_outstanding; //folders queued or being listed
+    QAtomicInt m_sleepers;
+    QMutex m_idleMutex;
+    QWaitCondition m_idle;
 
 private:
-    static QStringList s_localMounts, s_remoteMounts; //TODO namespace
+    friend class ScanWorker;
+
+    void run() override;
+    void work(ScanWorker *worker);
+    void push(ScanWorker *worker, DirTask *task);
+    DirTask *steal(const ScanWorker *thief);
+    void scan(DirTask *task, ScanWorker *worker);
+    void finish(DirTask *task);
+    Folder *takeCachedTree(const QByteArray &path);
+    bool enterFilesystem(DirTask *task);
+    Filesystem filesystem(const DirTask *task);
 };
 }
 
@@ -77,6 +77,8 @@ int main(int argc, char *argv[])
     options.addHelpOption();
     options.addVersionOption();
     options.addPositionalArgument(QStringLiteral("url"), i18n("Path or URL to scan"), i18n("[url]"));
+    const QCommandLineOption importOption(QStringLiteral("import"), i18n("Map the output of du, find or ncdu instead of a scan, - for the standard input"), i18n("listing"));
+    options.addOption(importOption);
     about.setupCommandLine(&options);
     options.process(app);
     about.processCommandLine(&options);
@@ -85,7 +87,10 @@ int main(int argc, char *argv[])
         MainWindow *mw = new MainWindow();
 
         QStringList args = options.positionalArguments();
-        if (args.count() > 0) {
+        if (options.isSet(importOption)) {
+            const QString listing = options.value(importOption);
+            mw->importListing(listing == QLatin1String("-") ? listing : QDir::current().absoluteFilePath(listing));
+        } else if (args.count() > 0) {
             mw->scan(QUrl::fromUserInput(args.at(0), QDir::currentPath(), QUrl::AssumeLocalFile));
         }
 
@@ -30,6 +30,8 @@
 #include "scan.h"
 #include "settingsDialog.h"
 #include "summaryWidget.h"
+#include "treeWatcher.h"
+#include "treeWriter.h"
 
 #include <cstdlib>            //std::exit()
 #include <iostream>
@@ -44,14 +46,17 @@
 #include <KShell>
 #include <KShortcutsDialog>
 #include <KStandardAction>
+#include <KToggleAction>
 #include <KUrlCompletion>   //locationbar
 
 #include <QApplication>     //setupActions()
 #include <QDir>
 #include <QFileDialog>
+#include <QSaveFile>
 #include <QScrollArea>
 #include <QStatusBar>
 #include <QLineEdit>
+#include <QLocale>
 
 namespace Filelight {
 
@@ -63,6 +68,7 @@ MainWindow::MainWindow()
     , m_started(false)
 {
     Config::read();
+    File::setApparentSizes(Config::apparentSizes);
 
     QScrollArea *scrollArea = new QScrollArea(this);
     scrollArea->setWidgetResizable(true);
@@ -97,6 +103,7 @@ MainWindow::MainWindow()
     connect(m_map, &RadialMap::Widget::folderCreated, this, &MainWindow::completed);
     connect(m_map, &RadialMap::Widget::folderCreated, this, &MainWindow::mapChanged);
     connect(m_map, &RadialMap::Widget::activated, this, &MainWindow::updateURL);
+    connect(m_map, &RadialMap::Widget::exportRequested, this, &MainWindow::exportListing);
 
     // TODO make better system
     connect(m_map, &RadialMap::Widget::giveMeTreeFor, this, &MainWindow::updateURL);
@@ -104,6 +111,32 @@ MainWindow::MainWindow()
 
     connect(m_manager, &ScanManager::completed, this, &MainWindow::folderScanCompleted);
     connect(m_manager, &ScanManager::aboutToEmptyCache, m_map, &RadialMap::Widget::invalidate);
+    connect(m_manager, &ScanManager::partialTree, this, [this](const Folder *tree) {
+        //fills in above the progress box as subfolders complete
+        m_map->preview(tree);
+        m_map->setVisible(tree != nullptr);
+    });
+
+    //the tree on the map follows the disk until it is scanned again or let go
+    m_watcher = new TreeWatcher(this);
+    connect(m_map, &RadialMap::Widget::folderCreated, this, [this](const Folder *tree) {
+        //an imported listing is not of the folders here
+        if (m_manager->imported(tree->url())) {
+            m_watcher->clear();
+        } else {
+            m_watcher->watch(tree);
+        }
+    });
+    connect(m_map, &RadialMap::Widget::invalidated, m_watcher, &TreeWatcher::clear);
+    connect(m_map, &RadialMap::Widget::aboutToDelete, m_watcher, &TreeWatcher::forget);
+    //a snapshot of the tree may still be being written
+    connect(m_map, &RadialMap::Widget::aboutToDelete, m_manager, &ScanManager::waitForSnapshot);
+    connect(m_watcher, &TreeWatcher::aboutToChange, m_manager, &ScanManager::waitForSnapshot);
+    connect(m_watcher, &TreeWatcher::aboutToDelete, m_map, &RadialMap::Widget::forget);
+    connect(m_watcher, &TreeWatcher::changed, this, &MainWindow::treeChanged);
+    connect(m_watcher, &TreeWatcher::overflowed, this, [this]() {
+        statusBar()->showMessage(i18n("Too many changes to follow, rescan for an exact map."));
+    });
 
     setStandardToolBarMenuEnabled(true);
     setupActions();
@@ -129,6 +162,37 @@ void MainWindow::scan(const QUrl &u)
     slotScanUrl(u);
 }
 
+void MainWindow::importListing(const QString &fileName)
+{
+    followMap();
+
+    if (m_manager->running())
+        m_manager->abort();
+
+    m_watcher->clear(); //the import empties the cache
+    m_numberOfFiles->setText(QString());
+
+    if (!m_manager->import(fileName)) {
+        return;
+    }
+
+    //the url is that of the root of the listing, known once it is read
+    setUrl(QUrl());
+
+    if (m_summary != nullptr)
+        m_summary->hide();
+    m_stateWidget->show();
+    m_layout->addWidget(m_stateWidget);
+
+    const QString s = i18n("Importing: %1", QDir::toNativeSeparators(fileName));
+    stateChanged(QStringLiteral("scan_started"));
+    emit started();
+    emit setWindowCaption(s);
+    statusBar()->showMessage(s);
+    m_map->hide();
+    m_map->invalidate();
+}
+
 void MainWindow::setupActions() //singleton function
 {
     KActionCollection *const ac = actionCollection();
@@ -156,17 +220,43 @@ void MainWindow::setupActions() //singleton function
     action->setText(i18n("Scan &Root Folder"));
     action->setIcon(QIcon::fromTheme(QStringLiteral("folder-red")));
 
+    action = ac->addAction(QStringLiteral("scan_import"), this, &MainWindow::slotImportListing);
+    action->setText(i18n("&Import Listing..."));
+    action->setToolTip(i18n("Map the output of du, find or ncdu, made on this or another computer"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("document-import")));
+
+    action = ac->addAction(QStringLiteral("scan_export"), this, [this]() { exportListing(m_map->tree()); });
+    action->setText(i18n("E&xport Listing..."));
+    action->setToolTip(i18n("Write the folder mapped out in the JSON format of ncdu"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("document-export")));
+
     action = ac->addAction(QStringLiteral("scan_rescan"), this, &MainWindow::rescan);
     action->setText(i18n("Rescan"));
+    action->setToolTip(i18n("Scan again, listing only the folders where files were added, removed or renamed"));
     action->setIcon(QIcon::fromTheme(QStringLiteral("view-refresh")));
     ac->setDefaultShortcut(action, QKeySequence::Refresh);
 
+    action = ac->addAction(QStringLiteral("scan_rescan_all"), this, &MainWindow::fullRescan);
+    action->setText(i18n("Rescan &Everything"));
+    action->setToolTip(i18n("Scan again from scratch, also noticing files that merely grew or shrank"));
+    ac->setDefaultShortcut(action, QKeySequence(Qt::SHIFT + Qt::Key_F5));
+
+
+    action = ac->addAction(QStringLiteral("scan_resume"), this, &MainWindow::slotResumeScan);
+    action->setText(i18n("&Continue Scan"));
+    action->setIcon(QIcon::fromTheme(QStringLiteral("media-playback-start")));
 
     action = ac->addAction(QStringLiteral("scan_stop"), this, &MainWindow::slotAbortScan);
     action->setText(i18n("Stop"));
     action->setIcon(QIcon::fromTheme(QStringLiteral("process-stop")));
     ac->setDefaultShortcut(action, Qt::Key_Escape);
 
+    KToggleAction *apparentSizes = ac->add<KToggleAction>(QStringLiteral("view_apparent_sizes"));
+    apparentSizes->setText(i18n("Show &Apparent Sizes"));
+    apparentSizes->setToolTip(i18n("Map the sizes files claim to have rather than the space they take on disk"));
+    apparentSizes->setChecked(Config::apparentSizes);
+    connect(apparentSizes, &KToggleAction::toggled, this, &MainWindow::toggleApparentSizes);
+
     action = ac->addAction(QStringLiteral("go"), m_combo,
                            static_cast<void (KHistoryComboBox::*)()>(&KHistoryComboBox::returnPressed));
     action->setText(i18n("Go"));
@@ -234,6 +324,45 @@ void MainWindow::slotScanRootFolder()
     slotScanPath(QDir::rootPath());
 }
 
+void MainWindow::slotImportListing()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, i18n("Select Listing to Import"), QString(),
+        i18n("du, find or ncdu Listings (*.txt *.du *.json);;All Files (*)"));
+    if (!fileName.isEmpty()) {
+        importListing(fileName);
+    }
+}
+
+void MainWindow::exportListing(const Folder *folder)
+{
+    if (!folder || m_manager->running()) {
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(this, i18n("Export Listing"),
+        QDir::home().filePath(QFile::decodeName(QByteArray(folder->name8Bit())).remove(QLatin1Char('/')) + QLatin1String(".json")),
+        i18n("ncdu Listings (*.json)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    //streamed straight from the tree, which nothing changes meanwhile
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QSaveFile file(fileName);
+    bool written = file.open(QIODevice::WriteOnly);
+    if (written) {
+        TreeWriter writer(&file, TreeWriter::Ncdu);
+        written = writer.write(folder) && file.commit();
+    }
+    QApplication::restoreOverrideCursor();
+
+    if (written) {
+        statusBar()->showMessage(i18n("Exported to %1", QDir::toNativeSeparators(fileName)));
+    } else {
+        KMessageBox::error(this, i18n("Could not write %1: %2", QDir::toNativeSeparators(fileName), file.errorString()));
+    }
+}
+
 void MainWindow::slotUp()
 {
     slotScanUrl(KIO::upUrl(url()));
@@ -277,6 +406,29 @@ void MainWindow::slotAbortScan()
     if (closeUrl()) action("scan_stop")->setEnabled(false);
 }
 
+void MainWindow::slotResumeScan()
+{
+    //the map stays up meanwhile, it is replaced once the folders are listed
+    if (m_manager->resume(url())) {
+        m_watcher->clear(); //the scan holds on to folders of the tree
+        stateChanged(QStringLiteral("scan_started"));
+        statusBar()->showMessage(i18n("Continuing scan: %1", prettyUrl()));
+    } else {
+        statusBar()->showMessage(i18n("There is nothing left to scan."));
+    }
+}
+
+void MainWindow::toggleApparentSizes(bool apparent)
+{
+    //no rescan needed, every file knows both sizes
+    Config::apparentSizes = apparent;
+    Config::write();
+    m_manager->waitForSnapshot(); //it records the sizes the tree is sorted by
+    File::setApparentSizes(apparent);
+    m_manager->sortCache();
+    m_map->refresh(1);
+}
+
 void MainWindow::scanStarted()
 {
     stateChanged(QStringLiteral("scan_started"));
@@ -340,7 +492,8 @@ void MainWindow::readProperties(const KConfigGroup &configgroup) //virtual
 
 void MainWindow::postInit()
 {
-    if (url().isEmpty()) //if url is not empty openUrl() has been called immediately after ctor, which happens
+    //if url is not empty openUrl() has been called immediately after ctor, which happens, an import sets it once done
+    if (url().isEmpty() && !m_manager->running())
     {
         m_map->hide();
         showSummary();
@@ -362,7 +515,7 @@ bool MainWindow::openUrl(const QUrl &u)
 
     QUrl uri = u.adjusted(QUrl::NormalizePathSegments);
     const QString localPath = uri.toLocalFile();
-    const bool isLocal = uri.isLocalFile();
+    const bool isLocal = uri.isLocalFile() && !m_manager->imported(uri); //an imported listing need not be of this machine
 
     if (uri.isEmpty())
     {
@@ -448,21 +601,40 @@ void MainWindow::configFilelight()
     dialog->show(); //deletes itself
 }
 
-bool MainWindow::start(const QUrl &url)
+void MainWindow::followMap()
 {
     if (!m_started) {
         connect(m_map, &RadialMap::Widget::mouseHover,
                 [&](const QString &msg) { statusBar()->showMessage(msg); });
-        connect(m_map, &RadialMap::Widget::folderCreated, statusBar(), &QStatusBar::clearMessage);
+        connect(m_map, &RadialMap::Widget::folderCreated, this, [this]() {
+            //the scan's error summary outlives the "generating map" message
+            statusBar()->showMessage(m_scanMessage);
+            m_scanMessage.clear();
+        });
         m_started = true;
     }
+}
+
+bool MainWindow::start(const QUrl &url, bool rescan)
+{
+    followMap();
 
     if (m_manager->running())
         m_manager->abort();
 
+    m_watcher->clear(); //cached trees may be handed to the scan
     m_numberOfFiles->setText(QString());
 
-    if (m_manager->start(url)) {
+    bool continueInterrupted = false;
+    const QDateTime interrupted = rescan ? QDateTime() : m_manager->interruptedScan(url);
+    if (interrupted.isValid()) {
+        const QString message = i18n("<qt>The scan of <i>'%1'</i> started %2 did not complete. Continue it from where it stopped?</qt>",
+                                     QDir::toNativeSeparators(url.toLocalFile()), QLocale().toString(interrupted, QLocale::ShortFormat));
+        continueInterrupted = KMessageBox::questionYesNo(this, message, i18n("Interrupted Scan"),
+                                                         KGuiItem(i18n("&Continue Scan")), KGuiItem(i18n("&Scan Again"))) == KMessageBox::Yes;
+    }
+
+    if (rescan ? m_manager->rescan(url) : m_manager->start(url, continueInterrupted)) {
         setUrl(url);
 
         const QString s = i18n("Scanning: %1", prettyUrl());
@@ -489,6 +661,21 @@ void MainWindow::rescan()
         return;
     }
 
+    //the folders that did not change are taken from the cached tree
+    m_map->hide();
+    m_stateWidget->show();
+    if (!start(url(), true)) {
+        fullRescan();
+    }
+}
+
+void MainWindow::fullRescan()
+{
+    if (m_summary && !m_summary->isHidden()) {
+        rescan();
+        return;
+    }
+
     //FIXME we have to empty the cache because otherwise rescan picks up the old tree..
     m_manager->emptyCache(); //causes canvas to invalidate
     m_map->hide();
@@ -501,6 +688,23 @@ void MainWindow::folderScanCompleted(Folder *tree)
     if (tree) {
         statusBar()->showMessage(i18n("Scan completed, generating map..."));
 
+        const uint folders = m_manager->errors().unreadableFolders();
+        const uint files = m_manager->errors().failedEntries();
+        if (m_manager->imported(tree->url())) {
+            if (url().isEmpty()) {
+                setUrl(tree->url());
+            }
+            m_scanMessage = files ? i18np("1 line of the listing could not be read", "%1 lines of the listing could not be read", files)
+                                  : i18n("Showing an imported listing, rescan to replace it with a scan of this computer");
+        } else if (m_manager->snapshotTaken().isValid()) {
+            m_scanMessage = i18n("Showing the scan of %1, rescan to bring it up to date",
+                                 QLocale().toString(m_manager->snapshotTaken(), QLocale::ShortFormat));
+        } else if (folders) {
+            m_scanMessage = i18np("1 folder was not readable", "%1 folders were not readable", folders);
+        } else if (files) {
+            m_scanMessage = i18np("1 file could not be examined", "%1 files could not be examined", files);
+        }
+
         m_stateWidget->hide();
         m_map->show();
         m_map->create(tree);
@@ -537,6 +741,13 @@ void MainWindow::mapChanged(const Folder *tree)
     m_numberOfFiles->setText(text);
 }
 
+void MainWindow::treeChanged()
+{
+    //files changed on disk, the tree is up to date already
+    m_map->refresh(1);
+    mapChanged(m_watcher->tree());
+}
+
 void MainWindow::showSummary()
 {
     if (m_summary == nullptr) {
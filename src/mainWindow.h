@@ -44,6 +44,7 @@ class HistoryCollection;
 namespace Filelight {
 
 class ScanManager;
+class TreeWatcher;
 class SummaryWidget;
 
 class MainWindow : public KXmlGuiWindow // Maybe use qmainwindow
@@ -54,6 +55,8 @@ public:
     MainWindow();
 
     void scan(const QUrl &u);
+    /// Maps the du, find or ncdu listing @p fileName instead of a scan.
+    void importListing(const QString &fileName);
 
 Q_SIGNALS:
     void started(); // FIXME: Could be replaced by direct func call once merged with mainwindow
@@ -67,9 +70,13 @@ private Q_SLOTS:
     void slotScanFolder();
     void slotScanHomeFolder();
     void slotScanRootFolder();
+    void slotImportListing();
+    void exportListing(const Folder*);
     bool slotScanUrl(const QUrl&);
     bool slotScanPath(const QString&);
     void slotAbortScan();
+    void slotResumeScan();
+    void toggleApparentSizes(bool);
 
     void configToolbars();
     void configKeys();
@@ -83,10 +90,12 @@ private Q_SLOTS:
     bool openUrl(const QUrl&);
     void configFilelight();
     void rescan();
+    void fullRescan();
 
     void postInit();
     void folderScanCompleted(Folder*);
     void mapChanged(const Folder*);
+    void treeChanged();
     void updateURL(const QUrl &);
 
 protected:
@@ -100,7 +109,8 @@ private:
     bool closeUrl();
     QString prettyUrl() const;
     void showSummary();
-    bool start(const QUrl&);
+    void followMap();
+    bool start(const QUrl&, bool rescan = false);
 
     KSqueezedTextLabel *m_status[2];
     KHistoryComboBox   *m_combo;
@@ -112,7 +122,9 @@ private:
     RadialMap::Widget  *m_map;
     ProgressBox        *m_stateWidget;
     ScanManager        *m_manager;
+    TreeWatcher        *m_watcher;
     QLabel             *m_numberOfFiles;
+    QString             m_scanMessage; //shown once the map of a scan is ready
 
     bool m_started;
 
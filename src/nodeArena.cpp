@@ -0,0 +1,183 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "nodeArena.h"
+
+#include "fileTree.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+NodeArena::NodeArena()
+        : m_blocks(nullptr)
+        , m_next(nullptr)
+        , m_end(nullptr)
+        , m_blockSize(FirstBlockSize)
+        , m_size(0)
+{
+}
+
+NodeArena::~NodeArena()
+{
+    for (Folder *folder : qAsConst(m_folders)) {
+        folder->~Folder();
+    }
+    while (m_blocks) {
+        Block *block = m_blocks;
+        m_blocks = block->next;
+        free(block);
+    }
+}
+
+File*
+NodeArena::newFile(const char *name, FileSize size, FileSize apparentSize)
+{
+    const char *copy = copyName(name);
+    void *memory = m_freeFiles.isEmpty() ? allocate(sizeof(File), alignof(File)) : m_freeFiles.takeLast();
+    return new (memory) File(copy, size, apparentSize, nullptr);
+}
+
+Folder*
+NodeArena::newFolder(const char *name)
+{
+    const char *copy = copyName(name);
+    if (!m_freeFolders.isEmpty()) {
+        Folder *folder = m_freeFolders.takeLast();
+        folder->~Folder();
+        return new (folder) Folder(copy);
+    }
+    Folder *folder = new (allocate(sizeof(Folder), alignof(Folder))) Folder(copy);
+    m_folders.append(folder);
+    return folder;
+}
+
+const char*
+NodeArena::copyName(const char *name)
+{
+    const size_t size = strlen(name) + 1;
+    //only names of the same size are reused, nothing is lost to what is left over
+    void *memory = size < size_t(m_freeNames.size()) && !m_freeNames.at(size).isEmpty()
+                   ? m_freeNames[size].takeLast() : allocate(size, 1);
+    return static_cast<const char*>(memcpy(memory, name, size));
+}
+
+void
+NodeArena::release(File *file)
+{
+    QVector<File*> files = { file };
+    while (!files.isEmpty()) {
+        File *f = files.takeLast();
+
+        const size_t size = strlen(f->m_name) + 1;
+        if (size < MaxReusedName) {
+            if (size >= size_t(m_freeNames.size())) {
+                m_freeNames.resize(size + 1);
+            }
+            m_freeNames[size].append(const_cast<char*>(f->m_name));
+        }
+
+        if (f->isFolder()) {
+            Folder *folder = static_cast<Folder*>(f);
+            files += folder->files;
+            //emptied right away, its file list need not wait for it to be reused
+            folder->~Folder();
+            new (folder) Folder("");
+            m_freeFolders.append(folder);
+        } else {
+            m_freeFiles.append(f);
+        }
+    }
+}
+
+void*
+NodeArena::grow(size_t size)
+{
+    //small trees, a summary say, don't take a whole big block
+    const size_t blockSize = qMax(m_blockSize, sizeof(Block) + size);
+    Block *block = static_cast<Block*>(malloc(blockSize));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    block->next = m_blocks;
+    m_blocks = block;
+    m_size += blockSize;
+    m_blockSize = qMin<size_t>(m_blockSize * 2, MaxBlockSize);
+
+    //fresh blocks are aligned for anything
+    char *data = reinterpret_cast<char*>(block + 1);
+    m_next = data + size;
+    m_end = reinterpret_cast<char*>(block) + blockSize;
+    return data;
+}
+
+void
+NodeArena::adopt(Folder *tree)
+{
+    NodeArena *other = tree->takeArena();
+    adopt(other);
+    delete other;
+}
+
+void
+NodeArena::adopt(NodeArena *other)
+{
+    m_freeFiles += other->m_freeFiles;
+    m_freeFolders += other->m_freeFolders;
+    if (m_freeNames.size() < other->m_freeNames.size()) {
+        m_freeNames.resize(other->m_freeNames.size());
+    }
+    for (int size = 0; size < other->m_freeNames.size(); ++size) {
+        m_freeNames[size] += other->m_freeNames.at(size);
+    }
+    other->m_freeFiles.clear();
+    other->m_freeFolders.clear();
+    other->m_freeNames.clear();
+
+    if (!other->m_blocks) {
+        m_folders += other->m_folders;
+        other->m_folders.clear();
+        return;
+    }
+
+    if (!m_blocks) {
+        //nothing allocated here yet, carry on where the other one stopped
+        m_blocks = other->m_blocks;
+        m_next = other->m_next;
+        m_end = other->m_end;
+        m_blockSize = other->m_blockSize;
+    } else {
+        //behind the block allocated from, what is left in the other's is lost
+        Block *last = other->m_blocks;
+        while (last->next) {
+            last = last->next;
+        }
+        last->next = m_blocks->next;
+        m_blocks->next = other->m_blocks;
+    }
+    m_size += other->m_size;
+    m_folders += other->m_folders;
+
+    other->m_blocks = nullptr;
+    other->m_next = other->m_end = nullptr;
+    other->m_blockSize = FirstBlockSize;
+    other->m_size = 0;
+    other->m_folders.clear();
+}
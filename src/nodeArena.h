@@ -0,0 +1,105 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef NODEARENA_H
+#define NODEARENA_H
+
+#include <QVector>
+#include <QtGlobal>
+
+class File;
+class Folder;
+typedef quint64 FileSize;
+
+/**
+ * Where the files and folders of a tree and their names come from.
+ *
+ * Nodes are carved from blocks by bumping a pointer, and all of them go at
+ * once when the arena is deleted, instead of one malloc() and one free()
+ * per node and name. Files removed from a tree are given back with
+ * release() and handed out again, so a watched tree that keeps changing
+ * stays about as large as it ever was, not as all it ever held.
+ *
+ * An arena is not thread safe. Every thread building a tree allocates from
+ * its own, and the arenas are joined with adopt() once the tree is
+ * complete. The root of a tree owns the arena, see Folder::arena().
+ */
+class NodeArena
+{
+public:
+    NodeArena();
+    /// Destroys the folders made here and frees all of it.
+    ~NodeArena();
+
+    File *newFile(const char *name, FileSize size, FileSize apparentSize);
+    Folder *newFolder(const char *name);
+    /// A copy of @p name that lives as long as the arena.
+    const char *copyName(const char *name);
+
+    /// Takes back @p file, just removed from a tree made here, with all a
+    /// folder holds. Nothing may point at them anymore.
+    void release(File *file);
+
+    /// Takes over everything @p other holds, leaving it empty.
+    void adopt(NodeArena *other);
+    /// Likewise takes over the arena of @p tree, which joins a tree made
+    /// here, and deletes what is left of it.
+    void adopt(Folder *tree);
+
+    /// The memory taken from the heap, in bytes.
+    quint64 size() const {
+        return m_size;
+    }
+
+private:
+    enum {
+        FirstBlockSize = 4096,
+        MaxBlockSize = 1 << 20,
+        MaxReusedName = 258 // NAME_MAX, a '/' and the terminator, longer ones are not reused
+    };
+
+    struct alignas(16) Block {
+        Block *next;
+    };
+
+    void *allocate(size_t size, size_t alignment) {
+        char *p = reinterpret_cast<char*>((quintptr(m_next) + alignment - 1) & ~quintptr(alignment - 1));
+        if (p + size > m_end) {
+            return grow(size);
+        }
+        m_next = p + size;
+        return p;
+    }
+    void *grow(size_t size);
+
+    Block *m_blocks; // the newest first
+    char *m_next;
+    char *m_end;
+    size_t m_blockSize; // of the next block, they double up to MaxBlockSize
+    quint64 m_size;
+    QVector<Folder*> m_folders; // their file lists live on the heap
+    QVector<File*> m_freeFiles; // released, see release()
+    QVector<Folder*> m_freeFolders; // likewise, emptied but still in m_folders
+    QVector<QVector<char*>> m_freeNames; // likewise, by size
+
+    Q_DISABLE_COPY(NodeArena)
+};
+
+#endif
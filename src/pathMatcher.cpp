@@ -0,0 +1,310 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "pathMatcher.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <fnmatch.h>
+#include <string.h>
+
+namespace Filelight
+{
+
+static bool
+hasWildcards(const char *begin, const char *end)
+{
+    for (const char *c = begin; c != end; ++c) {
+        if (*c == '*' || *c == '?' || *c == '[' || *c == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+PathMatcher::PathMatcher(const QStringList &rules)
+        : m_ruleCount(0)
+{
+    m_root = addNode();
+    m_anywhere = addNode();
+    m_nodes[m_anywhere].anyDepth = true;
+
+    for (const QString &rule : rules) {
+        addRule(rule);
+    }
+}
+
+int
+PathMatcher::addNode()
+{
+    m_nodes.append(Node());
+    return m_nodes.size() - 1;
+}
+
+int
+PathMatcher::addTrieNode()
+{
+    m_trieTargets.append(QVector<int>());
+    return m_trieTargets.size() - 1;
+}
+
+void
+PathMatcher::addRule(const QString &rule)
+{
+    QByteArray pattern = QFile::encodeName(rule.trimmed());
+    if (pattern.isEmpty() || pattern.startsWith('#')) {
+        return;
+    }
+
+    bool include = false;
+    if (pattern.startsWith('+') || pattern.startsWith('-')) {
+        include = pattern.startsWith('+');
+        pattern.remove(0, 1);
+    }
+
+    bool anchored = pattern.startsWith('/');
+    if (!anchored && pattern.startsWith("*/")) {
+        pattern.remove(0, 2); //"*/name" means name at any depth, as does just "name"
+    }
+
+    QList<QByteArray> components = pattern.split('/');
+    bool folderOnly = pattern.endsWith('/');
+    components.removeAll(QByteArray());
+    while (!components.isEmpty() && components.last() == "**") {
+        //everything below a folder goes with the folder
+        components.removeLast();
+        folderOnly = true;
+    }
+    if (components.isEmpty()) {
+        return;
+    }
+
+    int node = anchored ? m_root : m_anywhere;
+    for (const QByteArray &component : qAsConst(components)) {
+        if (component == "**") {
+            //a node of its own, the rules sharing the path so far do not match deeper
+            node = addDeep(node);
+        } else {
+            node = addComponent(node, component);
+        }
+    }
+
+    if (include) {
+        m_nodes[node].flags |= folderOnly ? IncludeFolder : IncludeEntry;
+    } else {
+        m_nodes[node].flags |= folderOnly ? ExcludeFolder : ExcludeEntry;
+    }
+    ++m_ruleCount;
+}
+
+int
+PathMatcher::addComponent(int node, const QByteArray &component)
+{
+    {
+        const Table &table = m_nodes[node].table;
+        const auto it = table.components.constFind(component);
+        if (it != table.components.constEnd()) {
+            return it.value();
+        }
+    }
+
+    const int target = addNode();
+    m_nodes[node].table.components.insert(component, target);
+
+    const char *begin = component.constData();
+    const char *end = begin + component.size();
+    if (!hasWildcards(begin, end)) {
+        m_nodes[node].table.literals.insert(component, target);
+    } else if (*begin == '*' && !hasWildcards(begin + 1, end)) {
+        if (m_nodes[node].table.suffixes == -1) {
+            m_nodes[node].table.suffixes = addTrieNode();
+        }
+        addToTrie(m_nodes[node].table.suffixes, end - 1, begin, -1, target);
+    } else if (end[-1] == '*' && !hasWildcards(begin, end - 1)) {
+        if (m_nodes[node].table.prefixes == -1) {
+            m_nodes[node].table.prefixes = addTrieNode();
+        }
+        addToTrie(m_nodes[node].table.prefixes, begin, end - 1, 1, target);
+    } else {
+        m_nodes[node].table.globs.append(qMakePair(component, target));
+    }
+    return target;
+}
+
+int
+PathMatcher::addDeep(int node)
+{
+    if (m_nodes[node].deep == -1) {
+        const int deep = addNode();
+        m_nodes[deep].anyDepth = true;
+        m_nodes[node].deep = deep;
+    }
+    return m_nodes[node].deep;
+}
+
+void
+PathMatcher::addToTrie(int root, const char *begin, const char *end, int step, int target)
+{
+    int trieNode = root;
+    for (const char *c = begin; c != end; c += step) {
+        const quint64 key = (quint64(trieNode) << 8) | uchar(*c);
+        const auto it = m_trieEdges.constFind(key);
+        if (it != m_trieEdges.constEnd()) {
+            trieNode = it.value();
+        } else {
+            const int next = addTrieNode();
+            m_trieEdges.insert(key, next);
+            trieNode = next;
+        }
+    }
+    m_trieTargets[trieNode].append(target);
+}
+
+void
+PathMatcher::matchTrie(int root, const char *begin, const char *end, int step, QVector<int> &targets) const
+{
+    //every node on the way ends a prefix (or suffix) of the name
+    int trieNode = root;
+    for (const char *c = begin; ; c += step) {
+        targets += m_trieTargets[trieNode];
+        if (c == end) {
+            break;
+        }
+        const auto it = m_trieEdges.constFind((quint64(trieNode) << 8) | uchar(*c));
+        if (it == m_trieEdges.constEnd()) {
+            break;
+        }
+        trieNode = it.value();
+    }
+}
+
+void
+PathMatcher::match(const State &state, const char *name, QVector<int> &targets) const
+{
+    const int length = int(strlen(name));
+    const QByteArray key = QByteArray::fromRawData(name, length);
+
+    for (int node : state) {
+        const Table &table = m_nodes[node].table;
+
+        const auto it = table.literals.constFind(key);
+        if (it != table.literals.constEnd()) {
+            targets.append(it.value());
+        }
+        if (table.prefixes != -1) {
+            matchTrie(table.prefixes, name, name + length, 1, targets);
+        }
+        if (table.suffixes != -1 && length) {
+            matchTrie(table.suffixes, name + length - 1, name - 1, -1, targets);
+        }
+        for (const auto &glob : table.globs) {
+            if (fnmatch(glob.first.constData(), name, 0) == 0) {
+                targets.append(glob.second);
+            }
+        }
+    }
+}
+
+bool
+PathMatcher::verdict(const QVector<int> &targets, bool folder) const
+{
+    uint flags = 0;
+    for (int node : targets) {
+        flags |= m_nodes[node].flags;
+    }
+
+    const uint exclude = folder ? (ExcludeEntry | ExcludeFolder) : ExcludeEntry;
+    const uint include = folder ? (IncludeEntry | IncludeFolder) : IncludeEntry;
+    return (flags & exclude) && !(flags & include);
+}
+
+PathMatcher::State
+PathMatcher::enter(const State &state, const QVector<int> &targets) const
+{
+    State inner;
+    for (int node : state) {
+        if (m_nodes[node].anyDepth) {
+            inner.append(node);
+        }
+    }
+    inner += targets;
+    //"**" matches no folder too, so it comes into play with the node before it
+    for (int i = 0; i < inner.size(); ++i) {
+        const int deep = m_nodes[inner.at(i)].deep;
+        if (deep != -1) {
+            inner.append(deep);
+        }
+    }
+
+    std::sort(inner.begin(), inner.end());
+    inner.erase(std::unique(inner.begin(), inner.end()), inner.end());
+    return inner;
+}
+
+PathMatcher::State
+PathMatcher::start(const QByteArray &path) const
+{
+    State state;
+    if (isEmpty()) {
+        return state;
+    }
+
+    state = enter(state, { m_root, m_anywhere });
+    for (const QByteArray &component : path.split('/')) {
+        if (component.isEmpty()) {
+            continue;
+        }
+        QVector<int> targets;
+        match(state, component.constData(), targets);
+        state = enter(state, targets);
+    }
+    return state;
+}
+
+bool
+PathMatcher::excludesFolder(const State &state, const char *name, State *inner) const
+{
+    if (state.isEmpty()) {
+        return false;
+    }
+
+    QVector<int> targets;
+    match(state, name, targets);
+    if (verdict(targets, true)) {
+        return true;
+    }
+    *inner = enter(state, targets);
+    return false;
+}
+
+bool
+PathMatcher::excludesFile(const State &state, const char *name) const
+{
+    if (state.isEmpty()) {
+        return false;
+    }
+
+    QVector<int> targets;
+    match(state, name, targets);
+    return verdict(targets, false);
+}
+
+}
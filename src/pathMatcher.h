@@ -0,0 +1,118 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef PATHMATCHER_H
+#define PATHMATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+namespace Filelight
+{
+
+/**
+ * Decides which entries a scan leaves out, compiled once from the rules
+ * in Config::skipList.
+ *
+ * A rule is an absolute path ("/home/me/.cache") or a glob ("*.tmp",
+ * "node_modules/", "/srv/app?/cache/"). Rules not starting
+ * with a slash match at any depth, a trailing slash restricts a rule to
+ * folders and "**" matches any number of folders. Rules starting with '+'
+ * are include rules, they win over exclude rules matching the same entry.
+ *
+ * The rules become an automaton over path components: each folder carries
+ * a State, the handful of nodes still in play, and every node keeps its
+ * outgoing names in a hash table and in prefix and suffix tries. Looking
+ * up an entry hence costs the same no matter how many rules there are,
+ * only globs that are neither "*suffix" nor "prefix*" are tried one by
+ * one.
+ */
+class PathMatcher
+{
+public:
+    typedef QVector<int> State;
+
+    explicit PathMatcher(const QStringList &rules);
+
+    bool isEmpty() const {
+        return m_ruleCount == 0;
+    }
+
+    /// @return the state for entries of the folder @p path, an encoded absolute path
+    State start(const QByteArray &path) const;
+
+    /// @return true if the folder @p name is excluded, otherwise @p inner is
+    /// set to the state for its entries
+    bool excludesFolder(const State &state, const char *name, State *inner) const;
+
+    bool excludesFile(const State &state, const char *name) const;
+
+private:
+    enum {
+        ExcludeEntry = 1,
+        ExcludeFolder = 2,
+        IncludeEntry = 4,
+        IncludeFolder = 8
+    };
+
+    /// The names leading out of a node.
+    struct Table {
+        QHash<QByteArray, int> components; // every component added, to share targets
+        QHash<QByteArray, int> literals;
+        int prefixes = -1; // roots in m_trieTargets, -1 while unused
+        int suffixes = -1;
+        QVector<QPair<QByteArray, int>> globs;
+    };
+
+    struct Node {
+        Table table;
+        bool anyDepth = false; // stays in play in all folders below
+        int deep = -1; // the node a "**" after this one leads to, in play along with it
+        uint flags = 0;
+    };
+
+    void addRule(const QString &rule);
+    int addComponent(int node, const QByteArray &component);
+    int addDeep(int node);
+    int addNode();
+    int addTrieNode();
+    void addToTrie(int root, const char *begin, const char *end, int step, int target);
+    void matchTrie(int root, const char *begin, const char *end, int step, QVector<int> &targets) const;
+    void match(const State &state, const char *name, QVector<int> &targets) const;
+    bool verdict(const QVector<int> &targets, bool folder) const;
+    State enter(const State &state, const QVector<int> &targets) const;
+
+    QVector<Node> m_nodes;
+    int m_root; // anchored rules start here
+    int m_anywhere; // the others here
+
+    /// Prefix and suffix tries of all tables, edges are keyed by the node
+    /// index shifted left by 8 plus the byte.
+    QHash<quint64, int> m_trieEdges;
+    QVector<QVector<int>> m_trieTargets;
+
+    int m_ruleCount;
+};
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "mainWindow.h"
 
 #include <KColorScheme>
+#include <KFormat>
 #include <KIO/Job>
 #include <KLocalizedString>
 
@@ -37,6 +38,9 @@
 ProgressBox::ProgressBox(QWidget *parent, Filelight::MainWindow *mainWindow, Filelight::ScanManager *scanManager)
         : QWidget(parent)
         , m_manager(scanManager)
+        , m_fileRate(0)
+        , m_byteRate(0)
+        , m_errors(0)
         , m_colorScheme(QPalette::Active, KColorScheme::Tooltip)
 {
     hide();
@@ -60,6 +64,9 @@ void
 ProgressBox::start() //slot
 {
     m_timer.start(50); //20 times per second - very smooth
+    m_lastSnapshot = m_manager->telemetry().snapshot();
+    m_fileRate = m_byteRate = 0;
+    m_errors = 0;
     report();
     show();
 }
@@ -67,7 +74,18 @@ ProgressBox::start() //slot
 void
 ProgressBox::report() //slot
 {
-    setText(m_manager->files());
+    using Filelight::ScanTelemetry;
+
+    //rates over a second are steadier than over a single tick
+    const ScanTelemetry::Snapshot snapshot = m_manager->telemetry().snapshot();
+    if (snapshot.elapsed - m_lastSnapshot.elapsed >= 1000 || snapshot.elapsed < m_lastSnapshot.elapsed) {
+        m_fileRate = snapshot.rate(ScanTelemetry::Files, m_lastSnapshot);
+        m_byteRate = snapshot.rate(ScanTelemetry::Bytes, m_lastSnapshot);
+        m_lastSnapshot = snapshot;
+    }
+    m_errors = snapshot[ScanTelemetry::Errors];
+
+    setText(int(snapshot[ScanTelemetry::Files] + snapshot[ScanTelemetry::Folders]));
     update(); //repaint();
 }
 
@@ -89,8 +107,16 @@ void
 ProgressBox::setText(int files)
 {
     m_text = i18np("%1 File", "%1 Files", files);
-    m_textWidth = fontMetrics().boundingRect(m_text).width();
-    m_textHeight = fontMetrics().height();
+    if (m_fileRate > 0 || m_byteRate > 0) {
+        m_text += QLatin1Char('\n') + i18nc("scan speed, %2 is a size like 5 MiB", "%1 files/s, %2/s",
+                                            qRound64(m_fileRate), KFormat().formatByteSize(m_byteRate));
+    }
+    if (m_errors) {
+        m_text += QLatin1Char('\n') + i18np("%1 error", "%1 errors", m_errors);
+    }
+    const QRect bounds = fontMetrics().boundingRect(QRect(), Qt::AlignCenter, m_text);
+    m_textWidth = bounds.width();
+    m_textHeight = bounds.height();
 }
 
 #define PIECES_NUM 4
@@ -26,6 +26,8 @@
 #include <KColorScheme>
 #include <QWidget>
 
+#include "scanTelemetry.h"
+
 namespace Filelight {
 class ScanManager;
 class MainWindow;
@@ -52,6 +54,10 @@ protected:
 private:
     QTimer m_timer;
     Filelight::ScanManager* m_manager;
+    Filelight::ScanTelemetry::Snapshot m_lastSnapshot; //rates are measured against this
+    double m_fileRate;
+    double m_byteRate;
+    quint64 m_errors;
     QString m_text;
     int m_textWidth;
     int m_textHeight;
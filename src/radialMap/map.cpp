@@ -34,12 +34,21 @@
 
 #include "Config.h"
 #include "fileTree.h"
+#include "nodeArena.h"
 #define SINCOS_H_IMPLEMENTATION (1)
 #include "sincos.h"
 #include "widget.h"
 
+/// Folders a time limited scan did not list are drawn hatched.
+static bool
+isEstimated(const RadialMap::Segment *segment)
+{
+    return !segment->isFake() && segment->file()->isFolder() && static_cast<const Folder*>(segment->file())->isEstimated();
+}
+
 RadialMap::Map::Map(bool summary)
         : m_signature(nullptr)
+        , m_fakeFiles(nullptr)
         , m_visibleDepth(DEFAULT_RING_DEPTH)
         , m_ringBreadth(MIN_RING_BREADTH)
         , m_innerRadius(0)
@@ -55,12 +64,15 @@ RadialMap::Map::Map(bool summary)
 RadialMap::Map::~Map()
 {
     delete [] m_signature;
+    delete m_fakeFiles;
 }
 
 void RadialMap::Map::invalidate()
 {
     delete [] m_signature;
     m_signature = nullptr;
+    delete m_fakeFiles;
+    m_fakeFiles = nullptr;
 
     m_visibleDepth = Config::defaultRingDepth;
 }
@@ -78,6 +90,8 @@ void RadialMap::Map::make(const Folder *tree, bool refresh)
 
         delete [] m_signature;
         m_signature = new QList<Segment*>[m_visibleDepth + 1];
+        delete m_fakeFiles;
+        m_fakeFiles = new NodeArena;
 
         m_root = tree;
 
@@ -197,7 +211,7 @@ bool RadialMap::Map::build(const Folder * const dir, const uint depth, uint a_st
                 KFormat().formatByteSize(hiddenSize/hiddenFileCount));
 
 
-        (m_signature + depth)->append(new Segment(new File(QFile::encodeName(s).constData(), hiddenSize), a_start, a_end - a_start, true));
+        (m_signature + depth)->append(new Segment(m_fakeFiles->newFile(QFile::encodeName(s).constData(), hiddenSize, hiddenSize), a_start, a_end - a_start, true));
     }
 
     return false;
@@ -311,6 +325,22 @@ void RadialMap::Map::colorise()
                     segment->setPalette(cp, cb);
                     continue;
 
+                case Filelight::SparseFiles: {
+                        //the further apart the apparent and allocated sizes the more colourful,
+                        //red where holes or compression save space, blue where blocks waste it
+                        const double apparent = qMax<FileSize>(segment->file()->apparentSize(), 1);
+                        const double allocated = qMax<FileSize>(segment->file()->allocatedSize(), 1);
+                        const int saturation = int(64 * log2(qMax(apparent, allocated) / qMin(apparent, allocated)));
+
+                        h = apparent > allocated ? 0 : 220;
+                        s1 = qMin(saturation, apparent > allocated ? 255 : 96);
+                        v1 = int(255.0 / darkness);
+                        cb.setHsv(h, s1, v1);
+                        cp.setHsv(h, qMin(s1 + 40, 255), v1 - int(contrast * v1));
+                        segment->setPalette(cp, cb);
+                        continue;
+                    }
+
                 default:
                     h  = int(segment->start() / 16);
                     s1 = 160;
@@ -328,6 +358,9 @@ void RadialMap::Map::colorise()
             } else if (!segment->file()->isFolder()) { //file
                 cb.setHsv(h, 17, v1);
                 cp.setHsv(h, 17, v2);
+            } else if (isEstimated(segment)) { //folder of unknown content
+                cb.setHsv(h, s1 / 3, v1);
+                cp.setHsv(h, s2, v2);
             } else { //folder
                 cb.setHsv(h, s1, v1); //v was 225
                 cp.setHsv(h, s2, v2); //v was 225 - delta
@@ -401,6 +434,11 @@ void RadialMap::Map::paint(bool antialias)
             paint.setBrush(segment->brush());
             paint.drawPie(rect, segment->start(), segment->length());
 
+            if (isEstimated(segment)) {
+                paint.setBrush(QBrush(segment->pen(), Qt::BDiagPattern));
+                paint.drawPie(rect, segment->start(), segment->length());
+            }
+
             if (!segment->hasHiddenChildren()) {
                 continue;
             }
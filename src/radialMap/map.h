@@ -68,6 +68,7 @@ private:
     bool build(const Folder* const dir, const uint depth =0, uint a_start =0, const uint a_end =5760);
 
     QList<Segment*> *m_signature;
+    NodeArena *m_fakeFiles; ///stand for the files too small to draw, made anew with the signature
 
     const Folder *m_root;
     uint m_minSize;
@@ -37,7 +37,6 @@ public:
             , m_file(f)
             , m_hasHiddenChildren(false)
             , m_fake(isFake) {}
-    ~Segment();
 
     uint          start() const {
         return m_angleStart;
@@ -127,6 +127,23 @@ RadialMap::Widget::create(const Folder *tree)
     emit folderCreated(tree);
 }
 
+void
+RadialMap::Widget::preview(const Folder *tree)
+{
+    //no segment is focused and nothing valid, so the mouse does nothing
+    if (isValid()) {
+        invalidate();
+    }
+    m_focus = nullptr;
+
+    if (tree) {
+        m_map.make(tree);
+    } else {
+        m_map.invalidate();
+    }
+    update();
+}
+
 void
 RadialMap::Widget::createFromCache(const Folder *tree)
 {
@@ -170,7 +187,8 @@ RadialMap::Widget::refresh(int filth)
         {
         case 1:
             m_focus=nullptr;
-            m_map.make(m_tree, true); //true means refresh only
+            if (m_tree) //not a preview()
+                m_map.make(m_tree, true); //true means refresh only
             break;
 
         case 2:
@@ -213,12 +231,3 @@ RadialMap::Widget::zoomOut() //slot
         Config::defaultRingDepth = m_map.m_visibleDepth;
     update();
 }
-
-
-RadialMap::Segment::~Segment()
-{
-    if (isFake())
-        delete m_file; //created by us in Builder::build()
-}
-
-
@@ -59,6 +59,10 @@ public:
     bool isValid() const {
         return m_tree != nullptr;
     }
+    /// The folder mapped, 0 if none.
+    const Folder *tree() const {
+        return m_tree;
+    }
 
     bool isSummary() const {
         return m_isSummary;
@@ -70,8 +74,13 @@ public Q_SLOTS:
     void zoomIn();
     void zoomOut();
     void create(const Folder*);
+    /// Maps the tree of a scan still running, which can't be browsed yet.
+    /// 0 drops it.
+    void preview(const Folder*);
     void invalidate();
     void refresh(int);
+    /// @p file is about to be deleted by someone else.
+    void forget(const File *file);
 
 private Q_SLOTS:
     void resizeTimeout();
@@ -85,6 +94,10 @@ Q_SIGNALS:
     void folderCreated(const Folder*);
     void mouseHover(const QString&);
     void giveMeTreeFor(const QUrl&);
+    /// @p file was deleted on disk and is about to be deleted from the tree.
+    void aboutToDelete(const File *file);
+    /// The user asked for @p folder to be written out as a listing.
+    void exportRequested(const Folder *folder);
 
 protected:
     void changeEvent(QEvent*) override;
@@ -116,7 +129,7 @@ private:
     Map              m_map;
     Segment          *m_rootSegment;
     const bool       m_isSummary;
-    const Segment    *m_toBeDeleted;
+    const File       *m_toBeDeleted;
     QLabel           m_tooltip;
 };
 }
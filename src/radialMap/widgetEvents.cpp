@@ -196,7 +196,16 @@ void RadialMap::Widget::mouseMoveEvent(QMouseEvent *e)
                 m_focus->file()->displayPath(),
                 m_focus->file()->humanReadableSize());
 
-        if (m_focus->file()->isFolder()) {
+        const Folder *estimated = m_focus->file()->isFolder() ? static_cast<const Folder*>(m_focus->file()) : nullptr;
+        if (estimated && estimated->isEstimated()) {
+            string += QLatin1Char('\n');
+            if (estimated->estimateMargin()) {
+                string += i18nc("Tooltip of a folder that was not scanned, %1 is a percentage",
+                        "Not scanned, the size is an estimate (±%1%)", estimated->estimateMargin());
+            } else {
+                string += i18nc("Tooltip of a folder that was not scanned", "Not scanned, the size is an estimate");
+            }
+        } else if (m_focus->file()->isFolder()) {
             int files = static_cast<const Folder*>(m_focus->file())->children();
             const uint percent = uint((100 * files) / (double)m_tree->children());
 
@@ -302,6 +311,7 @@ void RadialMap::Widget::mousePressEvent(QMouseEvent *e)
     // Actions in the right click menu
     QAction* openFileManager = nullptr;
     QAction* openTerminal = nullptr;
+    QAction* exportFolder = nullptr;
     QAction* centerMap = nullptr;
     QAction* openFile = nullptr;
     QAction* copyClipboard = nullptr;
@@ -317,6 +327,8 @@ void RadialMap::Widget::mousePressEvent(QMouseEvent *e)
             openTerminal = popup.addAction(QIcon::fromTheme(QStringLiteral( "utilities-terminal" )), i18n("Open &Terminal Here"));
         }
 
+        exportFolder = popup.addAction(QIcon::fromTheme(QStringLiteral( "document-export" )), i18n("E&xport as ncdu Listing..."));
+
         if (m_focus->file() != m_tree) {
             popup.addSeparator();
             centerMap = popup.addAction(QIcon::fromTheme(QStringLiteral( "zoom-in" )), i18n("&Center Map Here"));
@@ -343,6 +355,8 @@ void RadialMap::Widget::mousePressEvent(QMouseEvent *e)
                      );
     } else if (openTerminal && clicked == openTerminal) {
         KToolInvocation::invokeTerminal(QString(),url.path());
+    } else if (exportFolder && clicked == exportFolder) {
+        emit exportRequested(static_cast<const Folder*>(m_focus->file()));
     } else if (centerMap && clicked == centerMap) {
         emit activated(url); //activate first, this will cause UI to prepare itself
         createFromCache((Folder *)m_focus->file());
@@ -353,9 +367,9 @@ void RadialMap::Widget::mousePressEvent(QMouseEvent *e)
         mimedata->setUrls(QList<QUrl>() << url);
         QApplication::clipboard()->setMimeData(mimedata , QClipboard::Clipboard);
     } else if (clicked == deleteItem && m_focus->file() != m_tree) {
-        m_toBeDeleted = m_focus;
-        const QUrl url = Widget::url(m_toBeDeleted->file());
-        const QString message = m_toBeDeleted->file()->isFolder()
+        m_toBeDeleted = m_focus->file(); //the segment does not outlive a refresh
+        const QUrl url = Widget::url(m_toBeDeleted);
+        const QString message = m_toBeDeleted->isFolder()
                 ? i18n("<qt>The folder at <i>'%1'</i> will be <b>recursively</b> and <b>permanently</b> deleted.</qt>", url.toString())
                 : i18n("<qt><i>'%1'</i> will be <b>permanently</b> deleted.</qt>", url.toString());
         const int userIntention = KMessageBox::warningContinueCancel(
@@ -378,10 +392,12 @@ void RadialMap::Widget::deleteJobFinished(KJob *job)
 {
     QApplication::restoreOverrideCursor();
     setEnabled(true);
-    if (!job->error() && m_toBeDeleted) {
-        m_toBeDeleted->file()->parent()->remove(m_toBeDeleted->file());
-        delete m_toBeDeleted->file();
-        m_toBeDeleted = nullptr;
+    if (!job->error()) {
+        if (m_toBeDeleted) { //unless a watch saw it go first
+            emit aboutToDelete(m_toBeDeleted);
+            m_toBeDeleted->parent()->remove(m_toBeDeleted);
+            m_toBeDeleted = nullptr;
+        }
         m_focus = nullptr;
         m_map.make(m_tree, true);
         update();
@@ -389,6 +405,16 @@ void RadialMap::Widget::deleteJobFinished(KJob *job)
         KMessageBox::error(this, job->errorString(), i18n("Error while deleting"));
 }
 
+void RadialMap::Widget::forget(const File *file)
+{
+    for (const File *f = m_toBeDeleted; f; f = f->parent()) {
+        if (f == file) {
+            m_toBeDeleted = nullptr;
+            break;
+        }
+    }
+}
+
 void RadialMap::Widget::dropEvent(QDropEvent *e)
 {
     QList<QUrl> uriList = KUrlMimeData::urlsFromMimeData(e->mimeData());
@@ -21,6 +21,7 @@
 
 #include "remoteLister.h"
 #include "fileTree.h"
+#include "nodeArena.h"
 #include "scan.h"
 #include "filelight_debug.h"
 
@@ -50,8 +51,8 @@ struct Store {
     /// directories in this folder that need to be scanned before we can propagate()
     List stores;
 
-    Store(const QUrl &u, const QString &name, Store *s)
-            : url(u), folder(new Folder((name + QLatin1Char('/')).toUtf8().constData())), parent(s) { }
+    Store(const QUrl &u, const QString &name, Store *s, NodeArena *arena)
+            : url(u), folder(arena->newFolder((name + QLatin1Char('/')).toUtf8().constData())), parent(s) { }
 
 
     Store* propagate()
@@ -81,7 +82,8 @@ private:
 
 RemoteLister::RemoteLister(const QUrl &url, QWidget *parent, ScanManager* manager)
         : KDirLister(parent)
-        , m_root(new Store(url, url.url(), nullptr))
+        , m_arena(new NodeArena)
+        , m_root(new Store(url, url.url(), nullptr, m_arena))
         , m_store(m_root)
         , m_manager(manager)
 {
@@ -96,6 +98,7 @@ RemoteLister::RemoteLister(const QUrl &url, QWidget *parent, ScanManager* manage
 RemoteLister::~RemoteLister()
 {
     delete m_root;
+    delete m_arena; //what a canceled listing got to
 }
 
 void RemoteLister::onCanceled()
@@ -112,12 +115,14 @@ void RemoteLister::onCompleted()
     const KFileItemList items = KDirLister::items();
     for (KFileItemList::ConstIterator it = items.begin(), end = items.end(); it != end; ++it)
     {
-        if (it->isDir())
-            m_store->stores += new Store(it->url(), it->name(), m_store);
-        else
-            m_store->folder->append(it->name().toUtf8().constData(), it->size());
-
-        m_manager->m_files++;
+        if (it->isDir()) {
+            m_store->stores += new Store(it->url(), it->name(), m_store, m_arena);
+            m_manager->m_telemetry.add(0, ScanTelemetry::Folders);
+        } else {
+            m_store->folder->append(m_arena, it->name().toUtf8().constData(), it->size());
+            m_manager->m_telemetry.add(0, ScanTelemetry::Files);
+            m_manager->m_telemetry.add(0, ScanTelemetry::Bytes, it->size());
+        }
     }
 
 
@@ -153,6 +158,8 @@ void RemoteLister::onCompleted()
         qCDebug(FILELIGHT_LOG) << "I think we're done";
 
         Q_ASSERT(m_root == m_store);
+        m_store->folder->setArena(m_arena);
+        m_arena = nullptr;
         emit branchCompleted(m_store->folder);
 
         deleteLater();
@@ -45,6 +45,7 @@ private Q_SLOTS:
     void onCanceled();
 
 private:
+    NodeArena *m_arena; //the tree's, until it is complete
     struct Store *m_root, *m_store;
     ScanManager* m_manager;
 };
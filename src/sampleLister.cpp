@@ -0,0 +1,331 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "sampleLister.h"
+
+#include "Config.h"
+#include "fileTree.h"
+#include "nodeArena.h"
+#include "scanContext.h"
+#include "filelight_debug.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifndef S_BLKSIZE
+#define S_BLKSIZE 512
+#endif
+
+namespace Filelight
+{
+
+/// The biggest estimate converted to a FileSize, with room to add up.
+static const double MaxSize = 9.0e18;
+
+/// What a folder holds itself.
+struct Listing
+{
+    FileSize bytes; // allocated to its files
+    FileSize apparentBytes;
+    uint files; // files and folders
+    quint64 device;
+    LocalLister::FilesystemKind kind; // only looked at on another device than the folder sampled
+    QVector<QPair<QByteArray, PathMatcher::State>> folders; // with a trailing '/'
+};
+
+/**
+ * Lists the folder @p path. Its files are appended to @p folder if given,
+ * which is the root of its tree, the skip list rules in play there are @p state.
+ * A folder on a pseudo filesystem is left unlisted unless it is on @p device,
+ * or @p device is 0. One on another device without being mounted there, as
+ * told by @p mounts, counts as on @p device.
+ * @return errno if the folder could not be read, otherwise 0
+ */
+static int
+listFolder(const QByteArray &path, const PathMatcher &matcher, const PathMatcher::State &state, Listing *listing, quint64 device, LocalLister::MountTable *mounts, Folder *folder = nullptr)
+{
+    listing->bytes = 0;
+    listing->apparentBytes = 0;
+    listing->files = 0;
+    listing->device = 0;
+    listing->kind = LocalLister::OrdinaryFilesystem;
+    listing->folders.clear();
+
+    //readdir takes ownership of the descriptor
+    const int fd = open(path.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    DIR *dir = fd == -1 ? nullptr : fdopendir(fd);
+    if (!dir) {
+        const int error = errno;
+        if (fd != -1) {
+            close(fd);
+        }
+        return error;
+    }
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) == 0) {
+        listing->device = statbuf.st_dev;
+    }
+    if (device && listing->device != device && !LocalLister::isMountRoot(fd, path, mounts)) {
+        listing->device = device; //a btrfs subvolume, part of the filesystem sampled
+    }
+    if (device && listing->device != device) {
+        listing->kind = LocalLister::classifyFilesystem(fd, path);
+        if (listing->kind == LocalLister::PseudoFilesystem) {
+            closedir(dir);
+            return 0;
+        }
+    }
+
+    while (const dirent *ent = readdir(dir)) {
+        const char *name = ent->d_name;
+        if (qstrcmp(name, ".") == 0 || qstrcmp(name, "..") == 0) {
+            continue;
+        }
+
+#if defined(_DIRENT_HAVE_D_TYPE) || defined(DTTOIF)
+        bool isFolder = ent->d_type == DT_DIR;
+        if (!isFolder && ent->d_type != DT_REG && ent->d_type != DT_UNKNOWN) {
+            continue;
+        }
+#else
+        bool isFolder = false;
+#endif
+        if (!isFolder) {
+            if (fstatat(fd, name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1) {
+                continue;
+            }
+            isFolder = S_ISDIR(statbuf.st_mode);
+            if (!isFolder && !S_ISREG(statbuf.st_mode)) {
+                continue;
+            }
+        }
+
+        if (isFolder) {
+            PathMatcher::State inner;
+            if (!matcher.excludesFolder(state, name, &inner)) {
+                listing->folders.append(qMakePair(QByteArray(name) + '/', inner));
+                ++listing->files;
+            }
+        } else if (!matcher.excludesFile(state, name)) {
+            const FileSize size = FileSize(statbuf.st_blocks) * S_BLKSIZE;
+            listing->bytes += size;
+            listing->apparentBytes += statbuf.st_size;
+            ++listing->files;
+            if (folder) {
+                folder->append(folder->arena(), name, size, statbuf.st_size);
+            }
+        }
+    }
+    closedir(dir);
+    return 0;
+}
+
+class SampleWorker : public QThread
+{
+public:
+    SampleWorker(SampleLister *lister, int index)
+            : m_lister(lister)
+            , m_index(index) {}
+
+protected:
+    void run() override {
+        m_lister->sample(m_index);
+    }
+
+private:
+    SampleLister *m_lister;
+    const int m_index;
+};
+
+SampleLister::SampleLister(const QString &path, QHash<QByteArray, Folder*> *cachedTrees, ScanContext *parent)
+        : QThread()
+        , m_path(path)
+        , m_trees(cachedTrees)
+        , m_parent(parent)
+        , m_matcher(Config::skipList)
+        , m_probes(qMax(Config::sampleProbes, 1u))
+        , m_crossMounts(Config::scanAcrossMounts)
+        , m_crossRemoteMounts(Config::scanRemoteMounts)
+        , m_device(0)
+{
+}
+
+void
+SampleLister::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    //the folder itself is listed as usual
+    const QByteArray path = QFile::encodeName(m_path);
+    NodeArena *arena = new NodeArena;
+    Folder *tree = arena->newFolder(path.constData());
+    tree->setArena(arena);
+    const PathMatcher::State state = m_matcher.start(path);
+    Listing listing;
+    if (const int error = listFolder(path, m_matcher, state, &listing, 0, &m_mounts, tree)) {
+        m_parent->m_telemetry.addError(0, error);
+        m_parent->m_errors.addFolder(path, error);
+    }
+    m_device = listing.device;
+    m_parent->m_telemetry.add(0, ScanTelemetry::Files, listing.files - listing.folders.size());
+    m_parent->m_telemetry.add(0, ScanTelemetry::Bytes, listing.bytes);
+
+    //its subfolders are estimated, unless an earlier scan has them already
+    for (const auto &folder : qAsConst(listing.folders)) {
+        if (Folder *cached = m_trees->take(path + folder.first)) {
+            tree->append(cached, folder.first.constData());
+            arena->adopt(cached);
+            continue;
+        }
+        Folder *estimated = arena->newFolder(folder.first.constData());
+        estimated->setEstimated();
+        tree->append(estimated);
+        m_samples.append({ path + folder.first, folder.second, estimated, 0, 0, 0, 0, 0, 0 });
+    }
+    //the trees below a subfolder are of no use to us
+    for (Folder *cached : qAsConst(*m_trees)) {
+        Folder::deleteTree(cached);
+    }
+    delete m_trees;
+
+    const int threads = qBound(1, Config::scanThreads ? int(Config::scanThreads) : QThread::idealThreadCount(), int(ScanTelemetry::MaxWriters));
+    QVector<SampleWorker*> workers;
+    for (int i = 1; i < qMin(threads, m_samples.size()); ++i) {
+        workers.append(new SampleWorker(this, i));
+        workers.last()->start();
+    }
+    sample(0);
+    for (SampleWorker *worker : qAsConst(workers)) {
+        worker->wait();
+    }
+    qDeleteAll(workers);
+
+    for (const Sample &sample : qAsConst(m_samples)) {
+        //half the 95% confidence interval of the mean
+        const double margin = 1.96 * sample.bytesDeviation / sqrt(sample.probes);
+        //weighted descents can make out more than fits, and so can the margin of a tiny mean
+        sample.folder->setEstimate(FileSize(qBound(0.0, sample.bytes, MaxSize)), FileSize(qBound(0.0, sample.apparentBytes, MaxSize)),
+                                   uint(qBound(0.0, sample.files, double(UINT_MAX))),
+                                   sample.bytes > 0 ? uint(qBound(0.0, ceil(100 * margin / sample.bytes), double(UINT_MAX))) : 0);
+        qCDebug(FILELIGHT_LOG) << "Sampled" << sample.path << ":" << qint64(sample.bytes) << "bytes ±" << qint64(margin)
+                               << "," << qint64(sample.files) << "files ±" << qint64(1.96 * sample.filesDeviation / sqrt(sample.probes))
+                               << "from" << sample.probes << "probes";
+    }
+    std::sort(tree->files.begin(), tree->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+
+    const ScanTelemetry::Snapshot totals = m_parent->m_telemetry.snapshot();
+    qCDebug(FILELIGHT_LOG) << "Sampled" << m_samples.size() << "folders in" << timer.elapsed() << "ms, listing"
+                           << totals[ScanTelemetry::Folders] << "folders";
+    m_parent->m_errors.finish();
+
+    if (m_parent->m_abort.loadAcquire()) {
+        Folder::deleteTree(tree);
+        tree = nullptr;
+    }
+    emit branchCompleted(tree);
+}
+
+void
+SampleLister::sample(int worker)
+{
+    //folders near the top are on the way of most descents, so they are only listed once
+    QHash<QByteArray, Listing> listings;
+    QRandomGenerator random(QRandomGenerator::global()->generate());
+
+    ScanTelemetry &telemetry = m_parent->m_telemetry;
+
+    for (int i = m_next.fetchAndAddRelaxed(1); i < m_samples.size(); i = m_next.fetchAndAddRelaxed(1)) {
+        Sample &sample = m_samples[i];
+        listings.clear();
+
+        double bytesSum = 0, bytesSquares = 0, apparentSum = 0, filesSum = 0, filesSquares = 0;
+        uint probes = 0;
+        for (; probes < m_probes && !m_parent->m_abort.loadAcquire(); ++probes) {
+            QByteArray path = sample.path;
+            PathMatcher::State state = sample.matchState;
+            double weight = 1, bytes = 0, apparentBytes = 0, files = 0;
+
+            forever {
+                auto it = listings.find(path);
+                if (it == listings.end()) {
+                    it = listings.insert(path, Listing());
+                    if (const int error = listFolder(path, m_matcher, state, &it.value(), m_device, &m_mounts)) {
+                        telemetry.addError(worker, error);
+                    }
+                    telemetry.add(worker, ScanTelemetry::Folders);
+                    telemetry.add(worker, ScanTelemetry::Files, it->files - it->folders.size());
+                    telemetry.add(worker, ScanTelemetry::Bytes, it->bytes);
+                }
+                const Listing &listing = it.value();
+
+                //mount points show as empty folders in a scan that stays on one
+                //filesystem, pseudo filesystems always do, like in LocalLister
+                if (listing.device != m_device &&
+                    (!m_crossMounts || listing.kind == LocalLister::PseudoFilesystem ||
+                     (listing.kind == LocalLister::RemoteFilesystem && !m_crossRemoteMounts))) {
+                    break;
+                }
+
+                bytes += weight * listing.bytes;
+                apparentBytes += weight * listing.apparentBytes;
+                files += weight * listing.files;
+                if (listing.folders.isEmpty()) {
+                    break;
+                }
+
+                const auto &next = listing.folders.at(random.bounded(listing.folders.size()));
+                weight *= listing.folders.size();
+                path += next.first;
+                state = next.second;
+            }
+
+            bytesSum += bytes;
+            bytesSquares += bytes * bytes;
+            apparentSum += apparentBytes;
+            filesSum += files;
+            filesSquares += files * files;
+        }
+
+        if (probes) {
+            sample.probes = probes;
+            sample.bytes = bytesSum / probes;
+            sample.apparentBytes = apparentSum / probes;
+            sample.files = filesSum / probes;
+            if (probes > 1) {
+                sample.bytesDeviation = sqrt(qMax(0.0, (bytesSquares - bytesSum * sample.bytes) / (probes - 1)));
+                sample.filesDeviation = sqrt(qMax(0.0, (filesSquares - filesSum * sample.files) / (probes - 1)));
+            }
+        }
+    }
+}
+
+}//namespace Filelight
@@ -0,0 +1,93 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef SAMPLELISTER_H
+#define SAMPLELISTER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QThread>
+#include <QVector>
+
+#include "localLister.h"
+#include "pathMatcher.h"
+
+class Folder;
+
+namespace Filelight
+{
+class ScanContext;
+
+/**
+ * Estimates the subfolders of a folder from random descents instead of
+ * listing them.
+ *
+ * The folder itself is listed, then every subfolder gets
+ * Config::sampleProbes random walks from it down to a folder without
+ * subfolders. What each folder on the way holds, weighted by the product of
+ * the subfolder counts above it, adds up to an unbiased guess at the whole
+ * subtree (Knuth, "Estimating the efficiency of backtrack programs"). The
+ * subfolders end up as estimated folders that ScanManager::resume() can
+ * list later.
+ */
+class SampleLister : public QThread
+{
+    Q_OBJECT
+
+public:
+    SampleLister(const QString &path, QHash<QByteArray, Folder*> *cachedTrees, ScanContext *parent);
+
+    /// A subfolder to estimate and what came of it.
+    struct Sample {
+        QByteArray path;
+        PathMatcher::State matchState;
+        Folder *folder;
+        double bytes, bytesDeviation;
+        double apparentBytes;
+        double files, filesDeviation;
+        uint probes;
+    };
+
+Q_SIGNALS:
+    void branchCompleted(Folder* tree);
+
+private:
+    friend class SampleWorker;
+
+    void run() override;
+    void sample(int worker);
+
+    QString m_path;
+    QHash<QByteArray, Folder*> *m_trees; //by full path
+    ScanContext *m_parent;
+    PathMatcher m_matcher; //Config::skipList
+    const uint m_probes;
+    const bool m_crossMounts;
+    const bool m_crossRemoteMounts;
+    quint64 m_device; //of the folder sampled
+    LocalLister::MountTable m_mounts;
+
+    QVector<Sample> m_samples;
+    QAtomicInt m_next; //the sample the next idle worker takes on
+};
+}
+
+#endif
@@ -21,37 +21,229 @@
 
 #include "scan.h"
 
+#include "Config.h"
+#include "checkpoint.h"
 #include "remoteLister.h"
 #include "fileTree.h"
+#include "listingImport.h"
 #include "localLister.h"
+#include "nodeArena.h"
+#include "sampleLister.h"
+#include "snapshot.h"
 #include "filelight_debug.h"
 
 #include <QGuiApplication>
 #include <QCursor>
 #include <QDir>
-#include <QStringBuilder>
+#include <QFile>
+#include <QSet>
+#include <QStorageInfo>
+#include <QThread>
 
 namespace Filelight
 {
 
+/// Finds the folder @p path, given relative to @p tree. 0 if it isn't there.
+static Folder*
+findBranch(Folder *tree, const QString &path)
+{
+    //compared encoded, only the folders on the way are looked at
+    Folder *d = tree;
+    for (const QByteArray &component : QFile::encodeName(path).split('/')) {
+        if (component.isEmpty()) {
+            continue;
+        }
+        const QByteArray name = component + '/';
+
+        Folder *subfolder = nullptr;
+        for (File *file : qAsConst(d->files)) {
+            if (file->isFolder() && qstrcmp(file->name8Bit(), name.constData()) == 0) {
+                subfolder = static_cast<Folder*>(file);
+                break;
+            }
+        }
+        if (!subfolder) {
+            return nullptr;
+        }
+        d = subfolder;
+    }
+
+    return d;
+}
+
+/// Whether @p file is still in the tree @p root, a delete may have taken it
+/// or a folder above it out.
+static bool
+isInTree(const File *file, const Folder *root)
+{
+    for (; file != root; file = file->parent()) {
+        if (!file->parent() || !file->parent()->files.contains(const_cast<File*>(file))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+deleteTrees(const QList<Folder*> &trees)
+{
+    for (Folder *tree : trees) {
+        Folder::deleteTree(tree);
+    }
+}
+
+static QByteArray
+fullPath(const File *file)
+{
+    QByteArray path;
+    for (const File *f = file; f; f = f->parent()) {
+        path.prepend(f->name8Bit());
+    }
+    return path;
+}
+
+/// The folders a time limited scan left unlisted in @p tree, counting the
+/// others in @p listed.
+static QVector<Folder*>
+unlistedFolders(Folder *tree, uint *listed = nullptr)
+{
+    QVector<Folder*> unlisted;
+    QVector<Folder*> stack = { tree };
+    while (!stack.isEmpty()) {
+        Folder *folder = stack.takeLast();
+        if (folder->isEstimated()) {
+            unlisted.append(folder);
+            continue;
+        }
+        if (listed) {
+            ++*listed;
+        }
+        for (File *file : qAsConst(folder->files)) {
+            if (file->isFolder()) {
+                stack.append(static_cast<Folder*>(file));
+            }
+        }
+    }
+    return unlisted;
+}
+
+/**
+ * Guesses the size of the folders a time limited scan left unlisted.
+ *
+ * If the tree is a whole filesystem, what its statfs() says is used but the
+ * scan did not find is shared out evenly between them. Otherwise each is
+ * taken to be as large as the average folder listed.
+ */
+static void
+estimateUnlisted(Folder *tree)
+{
+    uint listed = 0;
+    const QVector<Folder*> unlisted = unlistedFolders(tree, &listed);
+    if (unlisted.isEmpty()) {
+        return;
+    }
+
+    //statfs only knows about allocated space
+    FileSize accounted = tree->allocatedSize();
+    FileSize accountedApparent = tree->apparentSize();
+    for (const Folder *folder : unlisted) {
+        accounted -= folder->allocatedSize();
+        accountedApparent -= folder->apparentSize();
+    }
+
+    FileSize remainder;
+    const QStorageInfo storage(tree->decodedName());
+    if (storage.isValid() && QDir::cleanPath(storage.rootPath()) == QDir::cleanPath(tree->decodedName())) {
+        const FileSize used = storage.bytesTotal() - storage.bytesFree();
+        remainder = used > accounted ? used - accounted : 0;
+    } else {
+        remainder = accounted / qMax(listed, 1u) * unlisted.size();
+    }
+
+    //the apparent sizes are taken to relate to the allocated ones as in what was listed
+    const FileSize share = remainder / unlisted.size();
+    const FileSize apparentShare = accounted ? FileSize(double(share) * accountedApparent / accounted) : share;
+
+    QSet<Folder*> resort;
+    for (Folder *folder : unlisted) {
+        folder->setEstimate(share, apparentShare, folder->children());
+        for (Folder *d = folder->parent(); d && !resort.contains(d); d = d->parent()) {
+            resort.insert(d);
+        }
+    }
+    for (Folder *folder : qAsConst(resort)) {
+        std::sort(folder->files.begin(), folder->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+    }
+
+    qCDebug(FILELIGHT_LOG) << unlisted.size() << "folders left unlisted, estimated at" << remainder << "bytes";
+}
+
+/// Loads the snapshot of a folder, a large one takes a while to build.
+class SnapshotReader : public QThread
+{
+public:
+    SnapshotReader(const QString &path, QHash<QByteArray, Folder*> *trees)
+            : path(path)
+            , trees(trees)
+            , tree(nullptr)
+    {}
+
+    const QString path;
+    QHash<QByteArray, Folder*> *const trees; //for the scan if there is no snapshot
+    Folder *tree; //0 if there is no snapshot
+    QDateTime taken;
+
+protected:
+    void run() override {
+        tree = Snapshot::load(QFile::encodeName(path), &taken);
+    }
+};
+
+/// Writes the snapshot of a cached tree, which must not change meanwhile.
+class SnapshotWriter : public QThread
+{
+public:
+    explicit SnapshotWriter(const Folder *tree)
+            : m_tree(tree)
+    {}
+
+protected:
+    void run() override {
+        Snapshot::save(m_tree);
+    }
+
+private:
+    const Folder *m_tree;
+};
+
 ScanManager::ScanManager(QObject *parent)
         : QObject(parent)
-        , m_abort(false)
-        , m_files(0)
         , m_mutex()
         , m_thread(nullptr)
+        , m_timeLimited(false)
+        , m_resumed(nullptr)
+        , m_imported(nullptr)
+        , m_snapshotWriter(nullptr)
+        , m_partial(nullptr)
+        , m_unscanned(nullptr)
+        , m_usedSpace(0)
 {
-    Filelight::LocalLister::readMounts();
     connect(this, &ScanManager::branchCacheHit, this, &ScanManager::foundCached, Qt::QueuedConnection);
+
+    m_previewTimer.setSingleShot(true);
+    m_previewTimer.setInterval(1000);
+    connect(&m_previewTimer, &QTimer::timeout, this, &ScanManager::updatePreview);
 }
 
 ScanManager::~ScanManager()
 {
     if (m_thread) {
         qCDebug(FILELIGHT_LOG) << "Attempting to abort scan operation...";
-        m_abort = true;
+        m_abort.storeRelease(1);
         m_thread->wait();
     }
+    waitForSnapshot();
+    dropPreview();
 
     //RemoteListers are QObjects and get automatically deleted
 }
@@ -61,7 +253,7 @@ bool ScanManager::running() const
     return m_thread && m_thread->isRunning();
 }
 
-bool ScanManager::start(const QUrl &url)
+bool ScanManager::start(const QUrl &url, bool continueInterrupted)
 {
     QMutexLocker locker(&m_mutex); // The m_mutex gets released once locker is destroyed (goes out of scope).
 
@@ -74,8 +266,16 @@ bool ScanManager::start(const QUrl &url)
         abort();
     }
 
-    m_files = 0;
-    m_abort = false;
+    m_telemetry.reset();
+    m_errors.reset();
+    m_abort.storeRelease(0);
+    m_timeLimited = false;
+    m_resumed = nullptr;
+    m_unlisted.clear();
+    m_branchPath.clear();
+    m_snapshotTaken = QDateTime();
+    dropPreview();
+    waitForSnapshot(); //cached trees may be handed to the scan
 
     if (!url.isLocalFile()) {
         QGuiApplication::changeOverrideCursor(Qt::BusyCursor);
@@ -92,7 +292,7 @@ bool ScanManager::start(const QUrl &url)
 
     if (!path.endsWith(QDir::separator())) path += QDir::separator();
 
-    QList<Folder*> *trees = new QList<Folder*>;
+    QHash<QByteArray, Folder*> *trees = new QHash<QByteArray, Folder*>;
 
     /* CHECK CACHE
          *   user wants: /usr/local/
@@ -112,28 +312,7 @@ bool ScanManager::start(const QUrl &url)
 
             qCDebug(FILELIGHT_LOG) << "Cache-(a)hit: " << cachePath;
 
-            QVector<QStringRef> split = path.midRef(cachePath.length()).split(QLatin1Char('/'));
-            Folder *d = folder;
-
-            while (!split.isEmpty() && d != nullptr) { //if NULL we have got lost so abort!!
-                if (split.first().isEmpty()) { //found the dir
-                    break;
-                }
-                QString s = split.first() % QLatin1Char('/'); // % is the string concatenation operator for QStringBuilder
-
-                QListIterator<File*> it(d->files);
-                d = nullptr;
-                while (it.hasNext()) {
-                    File *subfolder = it.next();
-                    if (s == subfolder->decodedName()) {
-                        d = (Folder*)subfolder;
-                        break;
-                    }
-                }
-
-                split.pop_front();
-            }
-
+            Folder *d = findBranch(folder, path.mid(cachePath.length()));
             if (d) {
                 delete trees;
 
@@ -148,28 +327,298 @@ bool ScanManager::start(const QUrl &url)
                 qWarning() << "Didn't find " << path << " in the cache!\n";
                 it.remove();
                 emit aboutToEmptyCache();
-                delete folder;
+                if (folder == m_imported) {
+                    m_imported = nullptr;
+                }
+                Folder::deleteTree(folder);
                 break; //do a full scan
             }
+        }  else if (folder == m_imported && cachePath.startsWith(path)) { //not from this machine, no use to the scan
+            it.remove();
+            emit aboutToEmptyCache();
+            m_imported = nullptr;
+            Folder::deleteTree(folder);
         }  else if (cachePath.startsWith(path)) { //then part of the requested tree is already scanned
             qCDebug(FILELIGHT_LOG) << "Cache-(b)hit: " << cachePath;
             it.remove();
-            trees->append(folder);
+            trees->insert(QByteArray(folder->name8Bit()), folder);
+        }
+    }
+
+    //what the interrupted scan completed is grafted like cached trees
+    const QByteArray encodedPath = QFile::encodeName(path);
+    if (continueInterrupted && trees->isEmpty()) {
+        *trees = Checkpoint::load(encodedPath);
+        if (Folder *tree = trees->take(encodedPath)) {
+            //it did complete after all
+            delete trees;
+            Checkpoint::remove(encodedPath);
+            m_cache.append(tree);
+            emit branchCacheHit(tree);
+            return true;
         }
     }
 
     QGuiApplication::changeOverrideCursor(QCursor(Qt::BusyCursor));
+
+    //nothing in memory, maybe a scan of an earlier session has it
+    if (trees->isEmpty() && Config::scanSnapshots) {
+        //built on another thread, snapshotLoaded() scans if there is none
+        SnapshotReader *reader = new SnapshotReader(path, trees);
+        connect(reader, &QThread::finished, this, &ScanManager::snapshotLoaded);
+        m_thread = reader;
+        m_thread->start();
+        return true;
+    }
+
+    startLister(path, trees);
+    return true;
+}
+
+void ScanManager::startLister(const QString &path, QHash<QByteArray, Folder*> *trees)
+{
+    m_scanPath = path;
     //starts listing by itself
-    m_thread = new Filelight::LocalLister(path, trees, this);
-    connect(m_thread, &LocalLister::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+    if (Config::sampleProbes) {
+        //a quick guess at the subfolders, resume() lists them properly
+        SampleLister *lister = new Filelight::SampleLister(path, trees, this);
+        connect(lister, &SampleLister::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+        m_thread = lister;
+    } else {
+        m_timeLimited = Config::scanTimeBudget > 0;
+        LocalLister *lister = new Filelight::LocalLister(path, trees, this);
+        connect(lister, &LocalLister::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+        connect(lister, &LocalLister::branchPublished, this, &ScanManager::previewBranch, Qt::QueuedConnection);
+        m_thread = lister;
+    }
+    m_thread->start();
+}
+
+void ScanManager::snapshotLoaded()
+{
+    SnapshotReader *reader = static_cast<SnapshotReader*>(sender());
+    reader->wait();
+    if (reader != m_thread || m_abort.loadAcquire()) {
+        Folder::deleteTree(reader->tree);
+        delete reader->trees;
+        if (reader == m_thread) {
+            cacheTree(nullptr); //like any scan aborted
+        } else { //from a scan since aborted
+            delete reader;
+        }
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    Folder *tree = reader->tree;
+    m_snapshotTaken = reader->taken;
+    if (!tree) {
+        startLister(reader->path, reader->trees);
+        delete reader;
+        return;
+    }
+
+    delete reader->trees;
+    delete reader;
+    m_thread = nullptr;
+
+    qCDebug(FILELIGHT_LOG) << "Loaded the snapshot taken" << m_snapshotTaken;
+    m_cache.append(tree);
+    emit completed(tree);
+    QGuiApplication::restoreOverrideCursor();
+}
+
+QDateTime ScanManager::interruptedScan(const QUrl &url) const
+{
+    if (!url.isLocalFile()) {
+        return QDateTime();
+    }
+
+    QString path = url.toLocalFile();
+    if (!path.endsWith(QDir::separator())) path += QDir::separator();
+
+    for (const Folder *folder : m_cache) {
+        if (path.startsWith(folder->decodedName())) {
+            return QDateTime();
+        }
+    }
+    return Checkpoint::find(QFile::encodeName(path));
+}
+
+bool ScanManager::resume(const QUrl &url)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (running() || !url.isLocalFile()) {
+        return false;
+    }
+
+    QString path = url.toLocalFile();
+    if (!path.endsWith(QDir::separator())) path += QDir::separator();
+
+    Folder *tree = nullptr;
+    for (Folder *folder : qAsConst(m_cache)) {
+        if (path.startsWith(folder->decodedName())) {
+            tree = folder;
+            break;
+        }
+    }
+    if (!tree) {
+        return false;
+    }
+
+    QVector<QByteArray> paths;
+    m_unlisted.clear();
+    for (Folder *folder : unlistedFolders(tree)) {
+        const QByteArray folderPath = fullPath(folder);
+        paths.append(folderPath);
+        m_unlisted.insert(folderPath, folder);
+    }
+    if (paths.isEmpty()) {
+        return false;
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Resuming scan of" << tree->decodedName() << "for" << paths.size() << "folders";
+
+    m_telemetry.reset();
+    m_errors.reset();
+    m_abort.storeRelease(0);
+    m_timeLimited = true;
+    m_resumed = tree;
+    m_branchPath = path.mid(tree->decodedName().length());
+
+    QGuiApplication::changeOverrideCursor(QCursor(Qt::BusyCursor));
+    LocalLister *lister = new Filelight::LocalLister(paths, this);
+    connect(lister, &LocalLister::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+    m_thread = lister;
+    m_thread->start();
+
+    return true;
+}
+
+bool ScanManager::rescan(const QUrl &url)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (running() || !url.isLocalFile()) {
+        return false;
+    }
+
+    QString path = url.toLocalFile();
+    if (!path.endsWith(QDir::separator())) path += QDir::separator();
+
+    Folder *tree = nullptr;
+    for (Folder *folder : qAsConst(m_cache)) {
+        if (path.startsWith(folder->decodedName())) {
+            tree = folder;
+            break;
+        }
+    }
+    if (!tree || tree == m_imported) { //an imported tree is replaced by a full scan
+        return false;
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Rescanning" << tree->decodedName();
+    waitForSnapshot();
+
+    //the lister takes the tree over, the map must let go of it first
+    emit aboutToEmptyCache();
+    m_cache.removeOne(tree);
+    deleteTrees(m_cache);
+    m_cache.clear();
+    m_imported = nullptr;
+
+    m_telemetry.reset();
+    m_errors.reset();
+    m_abort.storeRelease(0);
+    m_timeLimited = Config::scanTimeBudget > 0;
+    m_resumed = nullptr;
+    m_unlisted.clear();
+    m_branchPath = path.mid(tree->decodedName().length());
+
+    QGuiApplication::changeOverrideCursor(QCursor(Qt::BusyCursor));
+    LocalLister *lister = new Filelight::LocalLister(tree, this);
+    connect(lister, &LocalLister::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+    m_thread = lister;
     m_thread->start();
 
     return true;
 }
 
+bool ScanManager::import(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (running()) {
+        return false;
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Importing" << fileName;
+    waitForSnapshot();
+
+    //the listing may well overlap the trees cached, it replaces them
+    emit aboutToEmptyCache();
+    deleteTrees(m_cache);
+    m_cache.clear();
+    m_imported = nullptr;
+
+    m_telemetry.reset();
+    m_errors.reset();
+    m_abort.storeRelease(0);
+    m_timeLimited = false;
+    m_resumed = nullptr;
+    m_unlisted.clear();
+    m_branchPath.clear();
+    m_snapshotTaken = QDateTime();
+    dropPreview();
+
+    QGuiApplication::changeOverrideCursor(QCursor(Qt::BusyCursor));
+    ListingImport *import = new Filelight::ListingImport(fileName, this);
+    connect(import, &ListingImport::branchCompleted, this, &ScanManager::cacheTree, Qt::QueuedConnection);
+    m_thread = import;
+    m_thread->start();
+
+    return true;
+}
+
+bool ScanManager::imported(const QUrl &url) const
+{
+    if (!m_imported || !url.isLocalFile()) {
+        return false;
+    }
+
+    QString path = url.toLocalFile();
+    if (!path.endsWith(QDir::separator())) path += QDir::separator();
+
+    return path.startsWith(m_imported->decodedName());
+}
+
+void ScanManager::sortCache()
+{
+    QMutexLocker locker(&m_mutex);
+    waitForSnapshot();
+
+    QVector<Folder*> folders;
+    for (Folder *tree : qAsConst(m_cache)) {
+        folders.append(tree);
+    }
+    while (!folders.isEmpty()) {
+        Folder *folder = folders.takeLast();
+        std::sort(folder->files.begin(), folder->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+        for (File *file : qAsConst(folder->files)) {
+            if (file->isFolder()) {
+                folders.append(static_cast<Folder*>(file));
+            }
+        }
+    }
+}
+
 bool ScanManager::abort()
 {
-    m_abort = true;
+    m_abort.storeRelease(1);
+    //the aborted scan deletes the branches previewed with its arena
+    dropPreview();
 
     delete findChild<RemoteLister *>(QStringLiteral( "remote_lister" ));
 
@@ -178,22 +627,30 @@ bool ScanManager::abort()
 
 void ScanManager::emptyCache()
 {
-    m_abort = true;
+    m_abort.storeRelease(1);
+    dropPreview();
 
     if (m_thread && m_thread->isRunning()) {
         m_thread->wait();
     }
+    waitForSnapshot();
 
     emit aboutToEmptyCache();
 
-    qDeleteAll(m_cache);
+    deleteTrees(m_cache);
     m_cache.clear();
+    m_imported = nullptr;
 }
 
 void ScanManager::cacheTree(Folder *tree)
 {
     QMutexLocker locker(&m_mutex); // This gets released once it is destroyed.
 
+    dropPreview();
+    waitForSnapshot();
+
+    const bool imported = qobject_cast<ListingImport*>(m_thread);
+    const bool listed = qobject_cast<LocalLister*>(m_thread);
     if (m_thread) {
         qCDebug(FILELIGHT_LOG) << "Waiting for thread to terminate ...";
         m_thread->wait();
@@ -202,26 +659,150 @@ void ScanManager::cacheTree(Folder *tree)
         m_thread = nullptr;
     }
 
-    emit completed(tree);
+    if (m_resumed) {
+        //put the folders listed in place of their estimates
+        Folder *resumed = m_resumed;
+        m_resumed = nullptr;
+
+        if (tree) {
+            //the map may still point at the folders about to be replaced
+            emit aboutToEmptyCache();
+
+            for (File *file : qAsConst(tree->files)) {
+                Folder *folder = static_cast<Folder*>(file);
+                Folder *old = m_unlisted.value(QByteArray(folder->name8Bit()));
+                //deleted from the map meanwhile, what was listed goes with the arena
+                if (old && isInTree(old, resumed)) {
+                    old->parent()->replace(old, folder);
+                }
+            }
+            tree->files.clear();
+            resumed->arena()->adopt(tree);
+
+            estimateUnlisted(resumed);
+            if (Config::scanSnapshots && resumed != m_imported) {
+                saveSnapshot(resumed);
+            }
+            tree = findBranch(resumed, m_branchPath);
+        }
+        m_unlisted.clear();
+
+        emit completed(tree);
+        QGuiApplication::restoreOverrideCursor();
+        return;
+    }
+
+    if (tree && m_timeLimited) {
+        estimateUnlisted(tree);
+    }
+
+    if (tree && imported) {
+        m_imported = tree;
+    }
+
+    //with the estimates in, a later session starts from what the map shows
+    if (tree && listed && Config::scanSnapshots) {
+        saveSnapshot(tree);
+    }
+
+    //a rescan covers the whole tree, not just the folder it was asked for
+    Folder *branch = tree ? findBranch(tree, m_branchPath) : nullptr;
+    emit completed(branch ? branch : tree);
 
     if (tree) {
         //we don't cache foreign stuff
         //we don't recache stuff (thus only type 1000 events)
         m_cache.append(tree);
     } else { //scan failed
-        qDeleteAll(m_cache);
+        deleteTrees(m_cache);
         m_cache.clear();
+        m_imported = nullptr;
     }
 
     QGuiApplication::restoreOverrideCursor();
 }
 
+void ScanManager::saveSnapshot(const Folder *tree)
+{
+    m_snapshotWriter = new SnapshotWriter(tree);
+    m_snapshotWriter->start();
+}
+
+void ScanManager::waitForSnapshot()
+{
+    if (m_snapshotWriter) {
+        m_snapshotWriter->wait();
+        delete m_snapshotWriter;
+        m_snapshotWriter = nullptr;
+    }
+}
+
 void ScanManager::foundCached(Folder *tree)
 {
     emit completed(tree);
     QGuiApplication::restoreOverrideCursor();
 }
 
+void ScanManager::previewBranch(Folder *branch)
+{
+    //from a scan since aborted, or being aborted, its branches go with it
+    if (sender() != m_thread || m_abort.loadAcquire()) {
+        return;
+    }
+
+    if (!m_partial) {
+        NodeArena *arena = new NodeArena;
+        m_partial = arena->newFolder(QFile::encodeName(m_scanPath).constData());
+        m_partial->setArena(arena);
+
+        //the space a whole filesystem uses shows up front, as a placeholder
+        const QStorageInfo storage(m_scanPath);
+        if (storage.isValid() && QDir::cleanPath(storage.rootPath()) == QDir::cleanPath(m_scanPath)) {
+            m_usedSpace = storage.bytesTotal() - storage.bytesFree();
+            m_unscanned = arena->newFolder("unscanned/");
+            m_unscanned->setEstimated();
+            m_unscanned->setEstimate(m_usedSpace, m_usedSpace, 0);
+            m_partial->append(m_unscanned);
+        }
+    }
+    m_partial->preview(branch);
+
+    if (!m_previewTimer.isActive()) {
+        m_previewTimer.start();
+    }
+}
+
+void ScanManager::updatePreview()
+{
+    if (!m_partial) {
+        return;
+    }
+
+    if (m_unscanned) {
+        const FileSize scanned = m_partial->allocatedSize() - m_unscanned->allocatedSize();
+        const FileSize left = m_usedSpace > scanned ? m_usedSpace - scanned : 0;
+        m_unscanned->setEstimate(left, left, 0);
+    }
+    std::sort(m_partial->files.begin(), m_partial->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+
+    emit partialTree(m_partial);
+}
+
+void ScanManager::dropPreview()
+{
+    if (!m_partial) {
+        return;
+    }
+
+    m_previewTimer.stop();
+    emit partialTree(nullptr);
+
+    //the subfolders previewed belong to the scan, not to the arena of the preview
+    m_unscanned = nullptr;
+    Folder::deleteTree(m_partial);
+    m_partial = nullptr;
+}
+
 
 }
 
@@ -23,52 +23,109 @@
 #define SCAN_H
 
 #include <QObject>
+#include <QDateTime>
 #include <QMutex>
+#include <QHash>
 #include <QList>
+#include <QTimer>
+
+#include "scanContext.h"
 
 class Folder;
+class QThread;
 
 namespace Filelight
 {
 
-class LocalLister;
-
-class ScanManager : public QObject
+class ScanManager : public QObject, public ScanContext
 {
     Q_OBJECT
 
-    friend class LocalLister;
-    friend class RemoteLister;
-
 public:
     explicit ScanManager(QObject *parent);
     ~ScanManager() override;
 
-    bool start(const QUrl& path);
+    /// With @p continueInterrupted the subtrees an interrupted scan of
+    /// @p path completed are taken from its checkpoint, not scanned again.
+    bool start(const QUrl& path, bool continueInterrupted = false);
     bool running() const;
 
-    uint files() const {
-        return m_files;
+    /// When the interrupted scan start() can continue for @p path started,
+    /// invalid if there is none or @p path is cached anyway.
+    QDateTime interruptedScan(const QUrl& path) const;
+
+    /// Lists the folders a time limited scan left out of the tree holding
+    /// @p path, completed() is emitted once they are in place.
+    /// @return false if there is nothing left to list
+    bool resume(const QUrl& path);
+
+    /// Scans the cached tree holding @p path again, only listing the folders
+    /// whose entries changed since. The other cached trees are dropped.
+    /// @return false if no cached tree holds @p path
+    bool rescan(const QUrl& path);
+
+    /// Maps the du, find or ncdu listing @p fileName instead of scanning,
+    /// see ListingImport. The tree read is cached like a scanned one.
+    bool import(const QString &fileName);
+
+    /// Whether @p path is in the tree the last import() read. It does not
+    /// have to exist on this machine, rescan() and the folder watch leave it
+    /// alone, start() finds it in the cache.
+    bool imported(const QUrl &path) const;
+
+    /// when the snapshot the last start() loaded was taken,
+    /// invalid if it did not load one
+    QDateTime snapshotTaken() const {
+        return m_snapshotTaken;
     }
 
 public Q_SLOTS:
     bool abort();
     void emptyCache();
+    /// Sorts the cached trees again, after File::setApparentSizes().
+    void sortCache();
     void cacheTree(Folder*);
     void foundCached(Folder*);
+    /// Blocks until the snapshot of the tree cached last is written, it is
+    /// read on another thread meanwhile. Whatever changes a cached tree
+    /// calls this first.
+    void waitForSnapshot();
+
+private Q_SLOTS:
+    void snapshotLoaded();
+    void previewBranch(Folder*);
+    void updatePreview();
 
 Q_SIGNALS:
     void completed(Folder*);
     void aboutToEmptyCache();
     void branchCacheHit(Folder* tree);
+    /// A provisional tree of the scan running, holding the subfolders
+    /// completed so far. 0 once it is about to be deleted.
+    void partialTree(const Folder* tree);
 
 private:
-    bool m_abort;
-    uint m_files;
-
     QMutex m_mutex;
-    LocalLister *m_thread;
+    QThread *m_thread;
     QList<Folder*> m_cache;
+
+    bool m_timeLimited; //the scan running may leave folders unlisted
+    Folder *m_resumed; //the cached tree the scan running completes
+    Folder *m_imported; //the cached tree read by import(), 0 if none
+    QHash<QByteArray, Folder*> m_unlisted; //its folders being listed, by full path
+    QString m_branchPath; //the folder to show once done, relative to the tree scanned
+    QDateTime m_snapshotTaken;
+    QThread *m_snapshotWriter; //writes the snapshot of a tree cached, 0 once done
+
+    void startLister(const QString &path, QHash<QByteArray, Folder*> *trees);
+    void saveSnapshot(const Folder *tree);
+    void dropPreview();
+
+    QString m_scanPath; //of the scan running
+    Folder *m_partial; //the tree partialTree() shows, its subfolders belong to the scan
+    Folder *m_unscanned; //in m_partial, what the filesystem uses that was not scanned yet
+    quint64 m_usedSpace; //by the filesystem scanned
+    QTimer m_previewTimer; //limits how often the provisional tree is mapped
 };
 }
 
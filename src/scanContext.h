@@ -0,0 +1,68 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef SCANCONTEXT_H
+#define SCANCONTEXT_H
+
+#include "scanErrors.h"
+#include "scanTelemetry.h"
+
+#include <QAtomicInt>
+
+namespace Filelight
+{
+
+/**
+ * What the listers share with whoever runs them: the flag telling them to
+ * stop, the counters they update and the errors they meet. ScanManager is
+ * one, filelight-scan runs its listers with a plain one.
+ */
+class ScanContext
+{
+    friend class ListingImport;
+    friend class LocalLister;
+    friend class RemoteLister;
+    friend class SampleLister;
+
+public:
+    ScanContext() : m_abort(0) {}
+
+    /// files and folders found so far
+    uint files() const {
+        return m_telemetry.total(ScanTelemetry::Files) + m_telemetry.total(ScanTelemetry::Folders);
+    }
+
+    const ScanTelemetry &telemetry() const {
+        return m_telemetry;
+    }
+
+    /// what could not be read by the last scan
+    const ScanErrors &errors() const {
+        return m_errors;
+    }
+
+protected:
+    QAtomicInt m_abort; //set by the GUI thread, polled by the scan threads
+    ScanTelemetry m_telemetry; //written by the scan threads
+    ScanErrors m_errors;
+};
+}
+
+#endif
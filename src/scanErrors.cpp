@@ -0,0 +1,151 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "scanErrors.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+
+#include <errno.h>
+#include <string.h>
+
+namespace Filelight
+{
+
+static const char*
+describe(int error)
+{
+    switch (error) {
+    case EACCES:
+        return "Inadequate access permissions";
+    case EMFILE:
+        return "Too many file descriptors in use by Filelight";
+    case ENFILE:
+        return "Too many files are currently open in the system";
+    case ENOENT:
+        return "A component of the path does not exist, or the path is an empty string";
+    case ENOMEM:
+        return "Insufficient memory to complete the operation";
+    case ENOTDIR:
+        return "A component of the path is not a folder";
+    case EBADF:
+        return "Bad file descriptor";
+    case EFAULT:
+        return "Bad address";
+#ifndef Q_OS_WIN
+    case ELOOP: //NOTE shouldn't ever happen
+        return "Too many symbolic links encountered while traversing the path";
+#endif
+    case ENAMETOOLONG:
+        return "File name too long";
+    }
+    return strerror(error);
+}
+
+ScanErrors::ScanErrors()
+{
+    reset();
+}
+
+void
+ScanErrors::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_errors.clear();
+    m_unreadableFolders = 0;
+    m_failedEntries = 0;
+    m_logWindow.start();
+    m_logged = 0;
+    m_suppressed = 0;
+}
+
+void
+ScanErrors::addFolder(const QByteArray &path, int error)
+{
+    add({path, error, 0});
+}
+
+void
+ScanErrors::addEntries(const QByteArray &path, int error, uint count)
+{
+    add({path, error, count});
+}
+
+void
+ScanErrors::add(const Error &error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_errors.append(error);
+    if (error.count) {
+        m_failedEntries += error.count;
+    } else {
+        ++m_unreadableFolders;
+    }
+
+    if (m_logWindow.elapsed() >= 1000) {
+        m_logWindow.restart();
+        m_logged = 0;
+    }
+    if (m_logged >= LogsPerSecond) {
+        ++m_suppressed;
+        return;
+    }
+    ++m_logged;
+
+    if (error.count) {
+        qWarning() << describe(error.error) << ": " << error.count << "entries in" << error.path;
+    } else {
+        qWarning() << describe(error.error) << ": " << error.path;
+    }
+}
+
+void
+ScanErrors::finish()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_suppressed) {
+        qWarning() << m_suppressed << "more folders had errors," << m_unreadableFolders << "folders and"
+                   << m_failedEntries << "files could not be read in total";
+        m_suppressed = 0;
+    }
+}
+
+QVector<ScanErrors::Error>
+ScanErrors::errors() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errors;
+}
+
+uint
+ScanErrors::unreadableFolders() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_unreadableFolders;
+}
+
+uint
+ScanErrors::failedEntries() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failedEntries;
+}
+
+}
@@ -0,0 +1,84 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef SCANERRORS_H
+#define SCANERRORS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+
+namespace Filelight
+{
+
+/**
+ * The errors met during a scan, one row per folder and errno.
+ *
+ * Scanners report each folder once they are done with it, together with
+ * how many of its entries failed, so even a scan that is denied access
+ * everywhere only adds a row now and then. Only a few rows a second are
+ * logged, the rest is summed up when the scan ends.
+ */
+class ScanErrors
+{
+public:
+    struct Error {
+        QByteArray path; // the folder
+        int error; // errno
+        uint count; // entries of the folder that failed, 0 if the folder itself could not be read
+    };
+
+    ScanErrors();
+
+    void reset();
+
+    /// The folder @p path could not be opened or listed.
+    void addFolder(const QByteArray &path, int error);
+    /// @p count entries of the folder @p path could not be examined.
+    void addEntries(const QByteArray &path, int error, uint count);
+
+    /// Logs how many errors were not logged yet.
+    void finish();
+
+    QVector<Error> errors() const;
+    uint unreadableFolders() const;
+    uint failedEntries() const;
+
+private:
+    void add(const Error &error);
+
+    enum { LogsPerSecond = 5 };
+
+    mutable QMutex m_mutex;
+    QVector<Error> m_errors;
+    uint m_unreadableFolders;
+    uint m_failedEntries;
+
+    QElapsedTimer m_logWindow;
+    int m_logged; // in the current window
+    uint m_suppressed;
+
+    Q_DISABLE_COPY(ScanErrors)
+};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "scanTelemetry.h"
+
+#include <algorithm>
+#include <new>
+
+namespace Filelight
+{
+
+double
+ScanTelemetry::Snapshot::rate(Counter counter, const Snapshot &before) const
+{
+    const qint64 ms = elapsed - before.elapsed;
+    if (ms <= 0 || counters[counter] < before.counters[counter]) {
+        return 0;
+    }
+    return double(counters[counter] - before.counters[counter]) * 1000 / ms;
+}
+
+ScanTelemetry::ScanTelemetry()
+        : m_slots(static_cast<Slot*>(qMallocAligned(MaxWriters * sizeof(Slot), CacheLine)))
+{
+    Q_CHECK_PTR(m_slots);
+    for (int i = 0; i < MaxWriters; ++i) {
+        new (m_slots + i) Slot;
+    }
+    reset();
+}
+
+ScanTelemetry::~ScanTelemetry()
+{
+    for (int i = 0; i < MaxWriters; ++i) {
+        m_slots[i].~Slot();
+    }
+    qFreeAligned(m_slots);
+}
+
+void
+ScanTelemetry::reset()
+{
+    for (int i = 0; i < MaxWriters; ++i) {
+        for (QAtomicInteger<quint64> &counter : m_slots[i].counters) {
+            counter.storeRelease(0);
+        }
+    }
+    for (QAtomicInteger<uint> &count : m_errnos) {
+        count.storeRelease(0);
+    }
+    m_timer.start();
+}
+
+void
+ScanTelemetry::addError(int writer, int error)
+{
+    add(writer, Errors);
+    m_errnos[qBound(0, error, int(ErrnoCount) - 1)].fetchAndAddRelaxed(1);
+}
+
+quint64
+ScanTelemetry::total(Counter counter) const
+{
+    quint64 sum = 0;
+    for (int i = 0; i < MaxWriters; ++i) {
+        sum += m_slots[i].counters[counter].loadAcquire();
+    }
+    return sum;
+}
+
+ScanTelemetry::Snapshot
+ScanTelemetry::snapshot() const
+{
+    Snapshot snapshot;
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        snapshot.counters[counter] = total(Counter(counter));
+    }
+    snapshot.elapsed = m_timer.isValid() ? m_timer.elapsed() : 0;
+    return snapshot;
+}
+
+QVector<QPair<int, uint>>
+ScanTelemetry::errors() const
+{
+    QVector<QPair<int, uint>> errors;
+    for (int error = 0; error < ErrnoCount; ++error) {
+        const uint count = m_errnos[error].loadAcquire();
+        if (count) {
+            errors.append(qMakePair(error, count));
+        }
+    }
+    std::sort(errors.begin(), errors.end(), [](const QPair<int, uint> &a, const QPair<int, uint> &b) {
+        return a.second > b.second;
+    });
+    return errors;
+}
+
+}
@@ -0,0 +1,106 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef SCANTELEMETRY_H
+#define SCANTELEMETRY_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QPair>
+#include <QVector>
+
+namespace Filelight
+{
+
+/**
+ * Progress counters of the running scan.
+ *
+ * Every scan thread writes to its own slot, one cache line each, so the
+ * writers never contend. Readers sum up the slots without taking a lock,
+ * which gives a snapshot that may be a few increments stale but never
+ * blocks the scan.
+ */
+class ScanTelemetry
+{
+public:
+    enum Counter {
+        Files,
+        Folders,
+        Bytes, // accounted to the tree
+        StatCalls,
+        Errors,
+        CounterCount
+    };
+
+    enum { MaxWriters = 64 };
+
+    struct Snapshot {
+        quint64 counters[CounterCount];
+        qint64 elapsed; // ms since the scan started
+
+        quint64 operator[](Counter counter) const {
+            return counters[counter];
+        }
+
+        /// @return how fast @p counter grew since @p before, per second
+        double rate(Counter counter, const Snapshot &before) const;
+    };
+
+    ScanTelemetry();
+    ~ScanTelemetry();
+
+    /// Zeroes all counters, call before the scan threads start.
+    void reset();
+
+    void add(int writer, Counter counter, quint64 amount = 1) {
+        m_slots[writer].counters[counter].fetchAndAddRelaxed(amount);
+    }
+
+    /// Counts an error in both Errors and the per errno statistics.
+    void addError(int writer, int error);
+
+    Snapshot snapshot() const;
+    quint64 total(Counter counter) const;
+
+    /// @return errno values with how often each was seen, most frequent first
+    QVector<QPair<int, uint>> errors() const;
+
+private:
+    enum { ErrnoCount = 134 }; // everything above is counted in the last one
+    enum { CacheLine = 64 };
+
+    /// Padded to a cache line rather than aligned, as the telemetry is
+    /// allocated with new and that ignores alignas() before C++17.
+    struct Slot {
+        QAtomicInteger<quint64> counters[CounterCount];
+        char padding[CacheLine - CounterCount * sizeof(QAtomicInteger<quint64>)];
+    };
+    static_assert(sizeof(Slot) == CacheLine, "a slot takes one cache line");
+
+    Slot *m_slots; // MaxWriters of them, starting on a cache line
+    QAtomicInteger<uint> m_errnos[ErrnoCount]; // rare, no need to spread them out
+    QElapsedTimer m_timer;
+
+    Q_DISABLE_COPY(ScanTelemetry)
+};
+
+}
+
+#endif
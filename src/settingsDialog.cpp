@@ -55,6 +55,11 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent)
     colorSchemeLayout->addWidget(radioButton);
     m_schemaGroup->addButton(radioButton, Filelight::HighContrast);
 
+    radioButton = new QRadioButton(i18n("Sparse files"), this);
+    radioButton->setWhatsThis(i18n("Highlights files and folders whose apparent size is far off the space they take on disk, like sparse disk images or compressed files."));
+    colorSchemeLayout->addWidget(radioButton);
+    m_schemaGroup->addButton(radioButton, Filelight::SparseFiles);
+
     //read in settings before you make all those nasty connections!
     reset(); //makes dialog reflect global settings
 
@@ -72,9 +77,16 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent)
     connect(scanAcrossMounts, &QCheckBox::toggled, this, &SettingsDialog::startTimer);
     connect(dontScanRemoteMounts, &QCheckBox::toggled, this, &SettingsDialog::startTimer);
     connect(dontScanRemovableMedia, &QCheckBox::toggled, this, &SettingsDialog::startTimer);
+    connect(countHardlinksOnce, &QCheckBox::toggled, this, &SettingsDialog::startTimer);
     connect(scanAcrossMounts, &QCheckBox::toggled, this, &SettingsDialog::toggleScanAcrossMounts);
     connect(dontScanRemoteMounts, &QCheckBox::toggled, this, &SettingsDialog::toggleDontScanRemoteMounts);
     connect(dontScanRemovableMedia, &QCheckBox::toggled, this, &SettingsDialog::toggleDontScanRemovableMedia);
+    connect(countHardlinksOnce, &QCheckBox::toggled, this, &SettingsDialog::toggleCountHardlinksOnce);
+    connect(scanTimeBudget, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &SettingsDialog::changeScanTimeBudget);
+    connect(sampleProbes, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &SettingsDialog::changeSampleProbes);
+    connect(watchFolders, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &SettingsDialog::changeWatchFolders);
+    connect(scanSnapshots, &QCheckBox::toggled, this, &SettingsDialog::toggleScanSnapshots);
+    connect(checkpointInterval, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &SettingsDialog::changeCheckpointInterval);
 
     connect(useAntialiasing, &QCheckBox::toggled, this, &SettingsDialog::toggleUseAntialiasing);
     connect(varyLabelFontSizes, &QCheckBox::toggled, this, &SettingsDialog::toggleVaryLabelFontSizes);
@@ -106,6 +118,12 @@ void SettingsDialog::reset()
     scanAcrossMounts->setChecked(Config::scanAcrossMounts);
     dontScanRemoteMounts->setChecked(!Config::scanRemoteMounts);
     dontScanRemovableMedia->setChecked(!Config::scanRemovableMedia);
+    countHardlinksOnce->setChecked(Config::countHardlinksOnce);
+    scanTimeBudget->setValue(Config::scanTimeBudget);
+    sampleProbes->setValue(Config::sampleProbes);
+    watchFolders->setValue(Config::watchFolders);
+    scanSnapshots->setChecked(Config::scanSnapshots);
+    checkpointInterval->setValue(Config::checkpointInterval);
 
     dontScanRemoteMounts->setEnabled(Config::scanAcrossMounts);
     //  dontScanRemovableMedia.setEnabled(Config::scanAcrossMounts);
@@ -156,6 +174,36 @@ void SettingsDialog::toggleDontScanRemovableMedia(bool b)
     Config::scanRemovableMedia = !b;
 }
 
+void SettingsDialog::toggleCountHardlinksOnce(bool b)
+{
+    Config::countHardlinksOnce = b;
+}
+
+void SettingsDialog::changeScanTimeBudget(int seconds)
+{
+    Config::scanTimeBudget = seconds;
+}
+
+void SettingsDialog::changeSampleProbes(int probes)
+{
+    Config::sampleProbes = probes;
+}
+
+void SettingsDialog::changeWatchFolders(int folders)
+{
+    Config::watchFolders = folders;
+}
+
+void SettingsDialog::toggleScanSnapshots(bool b)
+{
+    Config::scanSnapshots = b;
+}
+
+void SettingsDialog::changeCheckpointInterval(int seconds)
+{
+    Config::checkpointInterval = seconds;
+}
+
 
 
 void SettingsDialog::addFolder()
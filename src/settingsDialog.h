@@ -47,6 +47,12 @@ public Q_SLOTS:
     void toggleScanAcrossMounts(bool);
     void toggleDontScanRemoteMounts(bool);
     void toggleDontScanRemovableMedia(bool);
+    void toggleCountHardlinksOnce(bool);
+    void changeScanTimeBudget(int);
+    void changeSampleProbes(int);
+    void changeWatchFolders(int);
+    void toggleScanSnapshots(bool);
+    void changeCheckpointInterval(int);
     void reset();
     void startTimer();
     void toggleUseAntialiasing(bool = true);
@@ -0,0 +1,352 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "snapshot.h"
+
+#include "Config.h"
+#include "fileTree.h"
+#include "nodeArena.h"
+#include "filelight_debug.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+#include <limits>
+#include <stdio.h> //rename()
+#include <string.h>
+
+namespace Filelight
+{
+
+static const char Magic[8] = { 'F', 'L', 'S', 'N', 'A', 'P', '\r', '\n' };
+static const quint32 Version = 1;
+static const quint32 ByteOrder = 0x01020304;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder; // ByteOrder as written by this machine
+    quint32 settings; // Snapshot::settingsHash() of the scan
+    quint32 apparentSizes; // the sizes the folders are sorted by
+    quint32 nodes;
+    quint32 namesSize;
+    qint64 taken; // ms since the epoch
+};
+
+struct SnapshotNode
+{
+    enum { IsFolder = 1, IsEstimated = 2 };
+
+    quint64 size; // allocated
+    quint64 apparentSize;
+    qint64 changeTime; // folders only
+    quint32 name; // offset into the names
+    quint32 end; // index of the node after everything below this one
+    quint32 children; // Folder::children(), for estimated folders the guess
+    quint16 flags;
+    quint16 margin; // Folder::estimateMargin()
+};
+
+static_assert(sizeof(SnapshotHeader) == 40 && sizeof(SnapshotNode) == 40, "the snapshot format has no padding");
+
+QString
+Snapshot::fileName(const QByteArray &path)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/snapshots/")
+           + QString::fromLatin1(QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex())
+           + QLatin1String(".snapshot");
+}
+
+quint32
+Snapshot::settingsHash()
+{
+    //what decides which files a scan counts
+    QByteArray settings = Config::skipList.join(QLatin1Char('\n')).toUtf8();
+    settings += char(Config::scanAcrossMounts);
+    settings += char(Config::scanRemoteMounts);
+    settings += char(Config::scanRemovableMedia);
+    settings += char(Config::countHardlinksOnce);
+
+    quint32 hash;
+    memcpy(&hash, QCryptographicHash::hash(settings, QCryptographicHash::Sha1).constData(), sizeof(hash));
+    return hash;
+}
+
+bool
+Snapshot::save(const Folder *tree)
+{
+    return save(tree, fileName(QByteArray(tree->name8Bit())));
+}
+
+bool
+Snapshot::save(const Folder *tree, const QString &name)
+{
+    //count first, the file is sized once and then filled through a mapping
+    quint64 nodes = 0;
+    quint64 namesSize = 0;
+    QVector<const Folder*> folders = { tree };
+    while (!folders.isEmpty()) {
+        const Folder *folder = folders.takeLast();
+        ++nodes;
+        namesSize += qstrlen(folder->name8Bit()) + 1;
+        for (const File *file : folder->files) {
+            if (file->isFolder()) {
+                folders.append(static_cast<const Folder*>(file));
+            } else {
+                ++nodes;
+                namesSize += qstrlen(file->name8Bit()) + 1;
+            }
+        }
+    }
+    if (nodes > std::numeric_limits<quint32>::max() || namesSize > std::numeric_limits<quint32>::max()) {
+        qCDebug(FILELIGHT_LOG) << "Too big for a snapshot:" << nodes << "entries";
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(name).absolutePath());
+    QFile file(name + QLatin1String(".new"));
+    const qint64 total = qint64(sizeof(SnapshotHeader) + nodes * sizeof(SnapshotNode) + namesSize);
+    uchar *map = nullptr;
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file.resize(total) || !(map = file.map(0, total))) {
+        qCDebug(FILELIGHT_LOG) << "Cannot write a snapshot to" << file.fileName() << file.errorString();
+        file.remove();
+        return false;
+    }
+
+    SnapshotNode *table = reinterpret_cast<SnapshotNode*>(map + sizeof(SnapshotHeader));
+    char *names = reinterpret_cast<char*>(table + nodes);
+    quint32 count = 0;
+    quint32 namesEnd = 0;
+
+    auto add = [&](const File *f) -> SnapshotNode& {
+        SnapshotNode &node = table[count++];
+        node.size = f->allocatedSize();
+        node.apparentSize = f->apparentSize();
+        node.changeTime = 0;
+        node.name = namesEnd;
+        node.end = count;
+        node.children = 0;
+        node.flags = 0;
+        node.margin = 0;
+
+        const uint length = qstrlen(f->name8Bit()) + 1;
+        memcpy(names + namesEnd, f->name8Bit(), length);
+        namesEnd += length;
+        return node;
+    };
+
+    //depth first, a folder's end is known once everything below it is written
+    struct Open {
+        const Folder *folder;
+        quint32 index;
+        int next; // the file to write next
+    };
+    QVector<Open> open;
+    auto addFolder = [&](const Folder *folder) {
+        SnapshotNode &node = add(folder);
+        node.changeTime = folder->changeTime();
+        node.children = folder->children();
+        node.flags = SnapshotNode::IsFolder | (folder->isEstimated() ? SnapshotNode::IsEstimated : 0);
+        node.margin = folder->estimateMargin();
+        open.append({ folder, count - 1, 0 });
+    };
+
+    addFolder(tree);
+    while (!open.isEmpty()) {
+        Open &top = open.last();
+        if (top.next == top.folder->files.size()) {
+            table[top.index].end = count;
+            open.removeLast();
+        } else {
+            const File *f = top.folder->files.at(top.next++);
+            if (f->isFolder()) {
+                addFolder(static_cast<const Folder*>(f));
+            } else {
+                add(f);
+            }
+        }
+    }
+
+    SnapshotHeader *header = reinterpret_cast<SnapshotHeader*>(map);
+    memcpy(header->magic, Magic, sizeof(Magic));
+    header->version = Version;
+    header->byteOrder = ByteOrder;
+    header->settings = settingsHash();
+    header->apparentSizes = File::apparentSizes();
+    header->nodes = quint32(nodes);
+    header->namesSize = quint32(namesSize);
+    header->taken = QDateTime::currentMSecsSinceEpoch();
+
+    file.unmap(map);
+    file.close();
+
+    //replaced in one go, a crash leaves either the old snapshot or the new one
+    if (rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(name).constData()) != 0) {
+        file.remove();
+        return false;
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Saved a snapshot of" << tree->decodedName() << "with" << nodes << "entries," << total << "bytes";
+    return true;
+}
+
+/// Builds the tree of @p path from the snapshot of @p root mapped at @p map.
+static Folder*
+build(const uchar *map, qint64 size, const QByteArray &root, const QByteArray &path, quint32 settings, QDateTime *taken)
+{
+    if (size < qint64(sizeof(SnapshotHeader))) {
+        return nullptr;
+    }
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader*>(map);
+    if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version ||
+            header->byteOrder != ByteOrder || header->settings != settings) {
+        qCDebug(FILELIGHT_LOG) << "Ignoring a snapshot of" << root << "taken by another version or with other settings";
+        return nullptr;
+    }
+
+    const quint32 nodes = header->nodes;
+    const quint32 namesSize = header->namesSize;
+    const SnapshotNode *table = reinterpret_cast<const SnapshotNode*>(map + sizeof(SnapshotHeader));
+    const char *names = reinterpret_cast<const char*>(table + nodes);
+    if (!nodes || !namesSize || qint64(sizeof(SnapshotHeader)) + qint64(nodes) * qint64(sizeof(SnapshotNode)) + namesSize != size ||
+            names[namesSize - 1] != '\0' || table[0].end != nodes || qstrcmp(names + qMin(table[0].name, namesSize - 1), root.constData()) != 0) {
+        qCDebug(FILELIGHT_LOG) << "Ignoring a damaged snapshot of" << root;
+        return nullptr;
+    }
+
+    //walk down to the folder asked for, skipping all other subtrees
+    quint32 index = 0;
+    for (const QByteArray &component : path.mid(root.size()).split('/')) {
+        if (component.isEmpty()) {
+            continue;
+        }
+        const QByteArray name = component + '/';
+        const quint32 end = table[index].end;
+        quint32 next = end;
+        for (quint32 i = index + 1; i < end; i = table[i].end) {
+            if (table[i].end <= i || table[i].end > end || table[i].name >= namesSize) {
+                qCDebug(FILELIGHT_LOG) << "Ignoring a damaged snapshot of" << root;
+                return nullptr;
+            }
+            if ((table[i].flags & SnapshotNode::IsFolder) && qstrcmp(names + table[i].name, name.constData()) == 0) {
+                next = i;
+                break;
+            }
+        }
+        if (next == end) {
+            return nullptr;
+        }
+        index = next;
+    }
+
+    //check everything below before building anything of it
+    const quint32 end = table[index].end;
+    QVector<quint32> ends = { end };
+    for (quint32 i = index + 1; i < end; ++i) {
+        while (i >= ends.last()) {
+            ends.removeLast();
+        }
+        const SnapshotNode &node = table[i];
+        const bool folder = node.flags & SnapshotNode::IsFolder;
+        if (node.name >= namesSize || node.end <= i || node.end > ends.last() || (!folder && node.end != i + 1)) {
+            qCDebug(FILELIGHT_LOG) << "Ignoring a damaged snapshot of" << root;
+            return nullptr;
+        }
+        if (folder) {
+            ends.append(node.end);
+        }
+    }
+
+    const bool sorted = bool(header->apparentSizes) == File::apparentSizes();
+    NodeArena *arena = new NodeArena;
+    auto makeFolder = [&](const SnapshotNode &node, const char *name) {
+        Folder *folder = arena->newFolder(name);
+        folder->setChangeTime(node.changeTime);
+        if (node.flags & SnapshotNode::IsEstimated) {
+            folder->setEstimated();
+            folder->setEstimate(node.size, node.apparentSize, node.children, node.margin);
+        }
+        return folder;
+    };
+
+    struct Open {
+        Folder *folder;
+        quint32 end;
+    };
+    Folder *tree = makeFolder(table[index], path.constData());
+    QVector<Open> open = { { tree, end } };
+    for (quint32 i = index + 1; !open.isEmpty(); ) {
+        if (i >= open.last().end) {
+            //complete, sizes add up as it is appended to its parent
+            Folder *folder = open.takeLast().folder;
+            if (!sorted) {
+                std::sort(folder->files.begin(), folder->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+            }
+            if (!open.isEmpty()) {
+                open.last().folder->append(folder);
+            }
+            continue;
+        }
+
+        const SnapshotNode &node = table[i];
+        if (node.flags & SnapshotNode::IsFolder) {
+            open.append({ makeFolder(node, names + node.name), node.end });
+        } else {
+            open.last().folder->append(arena, names + node.name, node.size, node.apparentSize);
+        }
+        ++i;
+    }
+
+    tree->setArena(arena);
+    *taken = QDateTime::fromMSecsSinceEpoch(header->taken);
+    return tree;
+}
+
+Folder*
+Snapshot::load(const QByteArray &path, QDateTime *taken)
+{
+    const quint32 settings = settingsHash();
+
+    //the snapshot of the folder itself, or of the closest folder above it
+    for (int i = path.lastIndexOf('/'); i >= 0; i = i ? path.lastIndexOf('/', i - 1) : -1) {
+        const QByteArray root = path.left(i + 1);
+        QFile file(fileName(root));
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        uchar *map = file.map(0, file.size());
+        if (!map) {
+            return nullptr;
+        }
+        Folder *tree = build(map, file.size(), root, path, settings, taken);
+        file.unmap(map);
+        return tree;
+    }
+    return nullptr;
+}
+
+}
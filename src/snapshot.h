@@ -0,0 +1,73 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+class Folder;
+
+namespace Filelight
+{
+
+/**
+ * Completed scans kept on disk, so they survive a restart or a crash.
+ *
+ * Every scanned folder gets a file in the cache dir, holding a header, a
+ * table of fixed size nodes and a blob of names. The nodes are stored depth
+ * first, a folder is followed by everything below it and knows the index
+ * where that ends, names are 32-bit offsets into the blob. Loading maps the
+ * file and walks the table down to the folder asked for, skipping every
+ * other subtree whole, and only builds the tree below it.
+ *
+ * A snapshot is only used while the scan settings it was taken with are
+ * unchanged, and as it may be out of date a rescan should follow.
+ */
+class Snapshot
+{
+public:
+    /// Writes the scan @p tree, named by its full path, replacing the
+    /// snapshot it was taken from if any. @return false on errors
+    static bool save(const Folder *tree);
+
+    /// Likewise writes @p tree to the file @p name, which filelight-scan
+    /// leaves wherever it is told to.
+    static bool save(const Folder *tree, const QString &name);
+
+    /// Builds the tree of the folder @p path, an absolute path with a
+    /// trailing separator, from the snapshot of it or of a folder above.
+    /// @p taken is set to when that was written.
+    /// @return nullptr if no snapshot holds it
+    static Folder *load(const QByteArray &path, QDateTime *taken);
+
+    /// Identifies the scan settings, anything scanned under other ones
+    /// would count other files.
+    static quint32 settingsHash();
+
+private:
+    static QString fileName(const QByteArray &path);
+};
+
+}
+
+#endif
@@ -138,9 +138,9 @@ void SummaryWidget::createDiskMaps()
         //                                                      row (=n/2)           column (0 or 1)
         qobject_cast<QGridLayout*>(layout())->addWidget(volume, layout()->count()/2, layout()->count() % 2);
 
-        Folder *tree = new Folder(disk.mount.toUtf8().constData());
-        tree->append("free", disk.free);
-        tree->append("used", disk.used);
+        Folder *tree = m_arena.newFolder(disk.mount.toUtf8().constData());
+        tree->append(&m_arena, "free", disk.free);
+        tree->append(&m_arena, "used", disk.used);
 
         map->create(tree); //must be done when visible
 
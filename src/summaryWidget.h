@@ -26,6 +26,8 @@
 
 #include <QWidget>
 
+#include "nodeArena.h"
+
 namespace Filelight {
 
 class SummaryWidget : public QWidget
@@ -40,6 +42,8 @@ Q_SIGNALS:
 
 private:
     void createDiskMaps();
+
+    NodeArena m_arena; //the trees of the disks
 };
 
 }
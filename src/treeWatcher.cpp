@@ -0,0 +1,404 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "treeWatcher.h"
+
+#include "Config.h"
+#include "fileTree.h"
+#include "filelight_debug.h"
+
+#include <QSocketNotifier>
+
+#include <algorithm>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h> //strerror()
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#endif
+
+#ifndef S_BLKSIZE
+#define S_BLKSIZE 512
+#endif
+
+namespace Filelight
+{
+
+#ifdef Q_OS_LINUX
+static const uint32_t WatchMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO
+                                | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+#endif
+
+TreeWatcher::TreeWatcher(QObject *parent)
+        : QObject(parent)
+        , m_fd(-1)
+        , m_notifier(nullptr)
+        , m_tree(nullptr)
+        , m_matcher(QStringList())
+        , m_listed(0)
+        , m_overflowed(false)
+        , m_exhausted(false)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(Interval);
+    connect(&m_timer, &QTimer::timeout, this, &TreeWatcher::apply);
+}
+
+TreeWatcher::~TreeWatcher()
+{
+    clear();
+}
+
+void
+TreeWatcher::watch(const Folder *tree)
+{
+    clear();
+
+#ifdef Q_OS_LINUX
+    if (!tree || !Config::watchFolders || !tree->url().isLocalFile()) {
+        return;
+    }
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1) {
+        qCDebug(FILELIGHT_LOG) << "Cannot follow changes:" << strerror(errno);
+        return;
+    }
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &TreeWatcher::readEvents);
+
+    m_tree = const_cast<Folder*>(tree); //it belongs to the cache of the ScanManager
+    m_matcher = PathMatcher(Config::skipList);
+
+    QByteArray path;
+    for (const File *f = tree; f; f = f->parent()) {
+        path.prepend(f->name8Bit());
+    }
+
+    //the biggest folders are watched first, a budget too small for the whole
+    //tree then still follows where most of the space is
+    auto smaller = [](const Watch &a, const Watch &b) { return a.folder->size() < b.folder->size(); };
+    QVector<Watch> heap = { Watch{ m_tree, path, m_matcher.start(path) } };
+    while (!heap.isEmpty() && hasBudget()) {
+        std::pop_heap(heap.begin(), heap.end(), smaller);
+        const Watch watch = heap.takeLast();
+        if (!addWatch(watch)) {
+            continue;
+        }
+
+        for (File *file : qAsConst(watch.folder->files)) {
+            Folder *folder = file->isFolder() ? static_cast<Folder*>(file) : nullptr;
+            if (!folder || folder->isEstimated()) { //unlisted folders are left to Continue Scan
+                continue;
+            }
+            QByteArray name(folder->name8Bit());
+            name.chop(1);
+            PathMatcher::State matchState;
+            m_matcher.excludesFolder(watch.matchState, name.constData(), &matchState);
+            heap.append(Watch{ folder, watch.path + folder->name8Bit(), matchState });
+            std::push_heap(heap.begin(), heap.end(), smaller);
+        }
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Following changes in" << m_watches.size() << "folders of" << tree->decodedName();
+#endif
+}
+
+void
+TreeWatcher::clear()
+{
+    m_timer.stop();
+    delete m_notifier;
+    m_notifier = nullptr;
+    if (m_fd != -1) {
+        close(m_fd); //drops all watches at once
+        m_fd = -1;
+    }
+
+    m_tree = nullptr;
+    m_watches.clear();
+    m_descriptors.clear();
+    m_dirty.clear();
+    m_touched.clear();
+    m_overflowed = false;
+    m_exhausted = false;
+}
+
+void
+TreeWatcher::forget(const File *file)
+{
+    if (!file->isFolder()) {
+        return;
+    }
+
+    QVector<const Folder*> folders = { static_cast<const Folder*>(file) };
+    while (!folders.isEmpty()) {
+        const Folder *folder = folders.takeLast();
+        m_touched.remove(const_cast<Folder*>(folder));
+
+        const auto it = m_descriptors.find(folder);
+        if (it != m_descriptors.end()) {
+#ifdef Q_OS_LINUX
+            inotify_rm_watch(m_fd, *it); //fails harmlessly if the folder is gone already
+#endif
+            m_watches.remove(*it);
+            m_descriptors.erase(it);
+        }
+
+        for (const File *f : folder->files) {
+            if (f->isFolder()) {
+                folders.append(static_cast<const Folder*>(f));
+            }
+        }
+    }
+}
+
+bool
+TreeWatcher::hasBudget() const
+{
+    return !m_exhausted && m_watches.size() < int(Config::watchFolders);
+}
+
+bool
+TreeWatcher::addWatch(const Watch &watch)
+{
+#ifdef Q_OS_LINUX
+    const int wd = inotify_add_watch(m_fd, watch.path.constData(), WatchMask);
+    if (wd == -1) {
+        if (errno == ENOSPC) {
+            //fs.inotify.max_user_watches is shared by all programs of the user
+            qCDebug(FILELIGHT_LOG) << "Out of inotify watches after" << m_watches.size() << "folders";
+            m_exhausted = true;
+        }
+        return false;
+    }
+    m_watches.insert(wd, watch);
+    m_descriptors.insert(watch.folder, wd);
+    return true;
+#else
+    Q_UNUSED(watch)
+    return false;
+#endif
+}
+
+void
+TreeWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                m_overflowed = true;
+            } else if (event->mask & IN_IGNORED) {
+                //the folder was deleted, its entry in the parent is looked at by itself
+                const auto it = m_watches.find(event->wd);
+                if (it != m_watches.end()) {
+                    m_descriptors.remove(it->folder);
+                    m_watches.erase(it);
+                }
+            } else if (event->len) {
+                //only the name is kept, what happened is seen when it is stat'ed
+                m_dirty.insert(qMakePair(int(event->wd), QByteArray(event->name)));
+            }
+        }
+    }
+
+    if (!m_timer.isActive() && (!m_dirty.isEmpty() || m_overflowed)) {
+        m_timer.start();
+    }
+#endif
+}
+
+void
+TreeWatcher::apply()
+{
+    const QSet<QPair<int, QByteArray>> dirty = m_dirty;
+    m_dirty.clear();
+    m_listed = 0;
+    if (!dirty.isEmpty()) {
+        emit aboutToChange();
+    }
+
+    for (const QPair<int, QByteArray> &entry : dirty) {
+        const auto it = m_watches.constFind(entry.first);
+        if (it == m_watches.constEnd()) { //its folder went away meanwhile
+            continue;
+        }
+        const Watch watch = *it; //the watch may go away while it is updated
+        if (update(watch, entry.second)) {
+            m_touched.insert(watch.folder);
+        }
+    }
+
+    if (m_overflowed) {
+        m_overflowed = false;
+        emit overflowed();
+    }
+    if (m_touched.isEmpty()) {
+        return;
+    }
+
+    //sizes changed all the way up
+    QSet<Folder*> resort;
+    for (Folder *folder : qAsConst(m_touched)) {
+        for (Folder *d = folder; d && !resort.contains(d); d = d->parent()) {
+            resort.insert(d);
+        }
+    }
+    m_touched.clear();
+    for (Folder *folder : qAsConst(resort)) {
+        std::sort(folder->files.begin(), folder->files.end(), [](File *a, File*b) { return a->size() > b->size(); });
+    }
+
+    qCDebug(FILELIGHT_LOG) << "Applied" << dirty.size() << "changes," << m_listed << "entries listed";
+    emit changed();
+}
+
+bool
+TreeWatcher::update(const Watch &watch, const QByteArray &name)
+{
+    Folder *folder = watch.folder;
+    const QByteArray folderName = name + '/';
+
+    File *file = nullptr;
+    for (File *f : qAsConst(folder->files)) {
+        if (qstrcmp(f->name8Bit(), f->isFolder() ? folderName.constData() : name.constData()) == 0) {
+            file = f;
+            break;
+        }
+    }
+
+    const QByteArray path = watch.path + name;
+    struct stat statbuf;
+    PathMatcher::State matchState;
+    bool isFile = false;
+    bool isFolder = false;
+    if (lstat(path.constData(), &statbuf) == 0) {
+        if (S_ISREG(statbuf.st_mode)) {
+            isFile = !m_matcher.excludesFile(watch.matchState, name.constData());
+        } else if (S_ISDIR(statbuf.st_mode)) {
+            isFolder = !m_matcher.excludesFolder(watch.matchState, name.constData(), &matchState);
+        }
+    }
+
+    bool changed = false;
+    if (file && (file->isFolder() ? !isFolder : !isFile)) { //gone, or replaced by something else
+        remove(file);
+        file = nullptr;
+        changed = true;
+    }
+
+    if (isFile) {
+        FileSize size = FileSize(statbuf.st_blocks) * S_BLKSIZE;
+        FileSize apparentSize = statbuf.st_size;
+        //as when scanning, a further link to data charged elsewhere costs nothing
+        if (Config::countHardlinksOnce && statbuf.st_nlink > 1
+                && (!file || (file->allocatedSize() == 0 && file->apparentSize() == 0))) {
+            size = apparentSize = 0;
+        }
+
+        if (!file) {
+            folder->insert(name.constData(), size, apparentSize);
+            changed = true;
+        } else if (file->allocatedSize() != size || file->apparentSize() != apparentSize) {
+            folder->resize(file, size, apparentSize);
+            changed = true;
+        }
+    } else if (isFolder && !file) { //created, or moved here with all it holds
+        list(Watch{ folder->insertFolder(folderName.constData()), path + '/', matchState });
+        changed = true;
+    }
+
+    return changed;
+}
+
+void
+TreeWatcher::list(const Watch &folder)
+{
+    QVector<Watch> folders = { folder };
+    while (!folders.isEmpty()) {
+        const Watch watch = folders.takeLast();
+        m_touched.insert(watch.folder);
+
+        if (m_listed >= MaxListed) { //Continue Scan can list the rest
+            watch.folder->setEstimated();
+            continue;
+        }
+
+        //watched before it is listed, so nothing created meanwhile is missed
+        if (hasBudget()) {
+            addWatch(watch);
+        }
+
+        //readdir takes ownership of the descriptor
+        const int fd = open(watch.path.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        DIR *dir = fd == -1 ? nullptr : fdopendir(fd);
+        if (!dir) {
+            if (fd != -1) {
+                close(fd);
+            }
+            continue;
+        }
+
+        while (const dirent *ent = readdir(dir)) {
+            const char *name = ent->d_name;
+            struct stat statbuf;
+            if (qstrcmp(name, ".") == 0 || qstrcmp(name, "..") == 0
+                    || fstatat(fd, name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1) {
+                continue;
+            }
+            ++m_listed;
+
+            if (S_ISDIR(statbuf.st_mode)) {
+                PathMatcher::State matchState;
+                if (!m_matcher.excludesFolder(watch.matchState, name, &matchState)) {
+                    const QByteArray folderName = QByteArray(name) + '/';
+                    folders.append(Watch{ watch.folder->insertFolder(folderName.constData()), watch.path + folderName, matchState });
+                }
+            } else if (S_ISREG(statbuf.st_mode) && !m_matcher.excludesFile(watch.matchState, name)) {
+                const bool charged = !Config::countHardlinksOnce || statbuf.st_nlink == 1;
+                watch.folder->insert(name, charged ? FileSize(statbuf.st_blocks) * S_BLKSIZE : 0, charged ? statbuf.st_size : 0);
+            }
+        }
+        closedir(dir);
+    }
+}
+
+void
+TreeWatcher::remove(File *file)
+{
+    emit aboutToDelete(file);
+    forget(file);
+    //its memory goes with the rest of the tree
+    file->parent()->remove(file);
+}
+
+}
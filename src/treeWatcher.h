@@ -0,0 +1,125 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef TREEWATCHER_H
+#define TREEWATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include "pathMatcher.h"
+
+class File;
+class Folder;
+class QSocketNotifier;
+
+namespace Filelight
+{
+
+/**
+ * Keeps the tree on the map in step with the disk instead of rescanning it.
+ *
+ * Up to Config::watchFolders folders get an inotify watch, the biggest ones
+ * first. Whatever is created, deleted, written to or moved in them is
+ * collected, and once a second the entries concerned are stat'ed again and
+ * the difference is applied to the tree, so a file written to a thousand
+ * times costs one stat. Folders that appear are listed and watched in turn.
+ *
+ * Lives in the GUI thread and must be cleared before the tree is handed to
+ * a scan or deleted. Does nothing on systems without inotify.
+ */
+class TreeWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TreeWatcher(QObject *parent);
+    ~TreeWatcher() override;
+
+    /// The folder watched from, nullptr while nothing is watched.
+    const Folder *tree() const {
+        return m_tree;
+    }
+
+public Q_SLOTS:
+    /// Follows the changes below @p tree, a folder of a cached tree.
+    void watch(const Folder *tree);
+    /// Stops following changes.
+    void clear();
+    /// Drops the watches below @p file, which someone else is about to delete.
+    void forget(const File *file);
+
+Q_SIGNALS:
+    /// The tree is about to change, see ScanManager::waitForSnapshot().
+    void aboutToChange();
+    /// @p file is about to be removed from the tree and deleted.
+    void aboutToDelete(const File *file);
+    /// The tree changed, it is sorted again already.
+    void changed();
+    /// Changes were lost, the tree may be off until it is scanned again.
+    void overflowed();
+
+private Q_SLOTS:
+    void readEvents();
+    void apply();
+
+private:
+    struct Watch {
+        Folder *folder;
+        QByteArray path; // with a trailing '/'
+        PathMatcher::State matchState;
+    };
+
+    bool hasBudget() const;
+    bool addWatch(const Watch &watch);
+    /// Looks at the entry @p name of a watched folder again. @return true if the tree changed
+    bool update(const Watch &watch, const QByteArray &name);
+    /// Lists the new folder @p watch holds, and the folders in it.
+    void list(const Watch &watch);
+    void remove(File *file);
+
+    enum {
+        Interval = 1000, // ms between updates of the tree
+        MaxListed = 10000 // new entries listed per update, folders beyond are left estimated
+    };
+
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QTimer m_timer;
+    Folder *m_tree;
+    PathMatcher m_matcher; //Config::skipList
+
+    QHash<int, Watch> m_watches; // by watch descriptor
+    QHash<const Folder*, int> m_descriptors;
+    QSet<QPair<int, QByteArray>> m_dirty; // entries of watched folders that changed
+    QSet<Folder*> m_touched; // folders whose sizes changed during an update
+    uint m_listed; // entries listed during an update
+    bool m_overflowed;
+    bool m_exhausted; // the system ran out of watches
+};
+
+}
+
+#endif
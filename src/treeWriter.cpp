@@ -0,0 +1,250 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "treeWriter.h"
+
+#include "define.h"
+#include "fileTree.h"
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QVector>
+
+using namespace Filelight;
+
+static const int BufferSize = 1 << 20;
+
+TreeWriter::TreeWriter(QIODevice *device, Format format)
+        : m_device(device)
+        , m_format(format)
+        , m_terminator('\n')
+        , m_failed(false)
+{
+}
+
+bool
+TreeWriter::write(const Folder *tree)
+{
+    struct Level {
+        const Folder *folder;
+        int next; // index in its files
+        int pathSize; // of the path up to and including it
+    };
+
+    m_buffer.reserve(BufferSize + 4096);
+    m_failed = false;
+
+    QByteArray path(tree->name8Bit());
+    for (const Folder *d = tree->parent(); d; d = d->parent()) {
+        path.prepend(d->name8Bit());
+    }
+    QVector<Level> levels;
+    levels.append({ tree, 0, path.size() });
+    if (m_format == JsonLines) {
+        writeEntry(path, tree);
+    } else if (m_format == Ncdu) {
+        //format 1.2, a list of the folder and then what it holds for each folder
+        m_buffer.append("[1,2,{\"progname\":\"" APP_NAME "\",\"progver\":\"" APP_VERSION "\",\"timestamp\":");
+        m_buffer.append(QByteArray::number(QDateTime::currentSecsSinceEpoch()));
+        m_buffer.append("},\n[");
+        writeNcduEntry(path.constData(), path.size(), tree);
+    }
+
+    while (!levels.isEmpty() && !m_failed) {
+        Level &level = levels.last();
+        path.truncate(level.pathSize);
+
+        if (level.next == level.folder->files.size()) {
+            if (m_format == Du) {
+                writeEntry(path, level.folder);
+            } else if (m_format == Ncdu) {
+                m_buffer.append(']');
+            }
+            levels.removeLast();
+            continue;
+        }
+
+        const File *file = level.folder->files.at(level.next++);
+        if (m_format == Ncdu) {
+            //nested, the names are all it takes
+            m_buffer.append(file->isFolder() ? ",\n[" : ",\n");
+            writeNcduEntry(file->name8Bit(), int(qstrlen(file->name8Bit())), file);
+            if (file->isFolder()) {
+                levels.append({ static_cast<const Folder*>(file), 0, path.size() });
+            }
+            continue;
+        }
+
+        path.append(file->name8Bit());
+        if (!file->isFolder()) {
+            writeEntry(path, file);
+        } else {
+            if (m_format == JsonLines) {
+                writeEntry(path, file);
+            }
+            levels.append({ static_cast<const Folder*>(file), 0, path.size() });
+        }
+    }
+
+    if (m_format == Ncdu) {
+        m_buffer.append("]\n");
+    }
+    return flush();
+}
+
+void
+TreeWriter::writeEntry(const QByteArray &path, const File *file)
+{
+    //folders are named with a trailing separator, which du does not print
+    int size = path.size();
+    if (size > 1 && path.at(size - 1) == '/') {
+        --size;
+    }
+
+    if (m_format == Du) {
+        writeNumber(file->size());
+        m_buffer.append('\t');
+        m_buffer.append(path.constData(), size);
+        m_buffer.append(m_terminator);
+    } else {
+        m_buffer.append("{\"path\":");
+        writeJsonString(path.constData(), size);
+        m_buffer.append(file->isFolder() ? ",\"type\":\"folder\",\"size\":" : ",\"type\":\"file\",\"size\":");
+        writeNumber(file->allocatedSize());
+        m_buffer.append(",\"apparent\":");
+        writeNumber(file->apparentSize());
+        if (file->isFolder()) {
+            const Folder *folder = static_cast<const Folder*>(file);
+            m_buffer.append(",\"entries\":");
+            writeNumber(folder->children());
+            if (folder->isEstimated()) {
+                m_buffer.append(",\"estimated\":true");
+            }
+        }
+        m_buffer.append("}\n");
+    }
+
+    if (m_buffer.size() >= BufferSize) {
+        flush();
+    }
+}
+
+void
+TreeWriter::writeNcduEntry(const char *name, int size, const File *file)
+{
+    if (size > 1 && name[size - 1] == '/') {
+        --size;
+    }
+
+    m_buffer.append("{\"name\":");
+    writeJsonString(name, size);
+    if (!file->isFolder()) {
+        m_buffer.append(",\"asize\":");
+        writeNumber(file->apparentSize());
+        m_buffer.append(",\"dsize\":");
+        writeNumber(file->allocatedSize());
+    } else if (static_cast<const Folder*>(file)->isEstimated()) {
+        //ncdu adds the sizes of a folder itself to its total
+        m_buffer.append(",\"asize\":");
+        writeNumber(file->apparentSize());
+        m_buffer.append(",\"dsize\":");
+        writeNumber(file->allocatedSize());
+        m_buffer.append(",\"read_error\":true");
+    }
+    m_buffer.append('}');
+
+    if (m_buffer.size() >= BufferSize) {
+        flush();
+    }
+}
+
+void
+TreeWriter::writeNumber(quint64 number)
+{
+    //QByteArray::number() would allocate for every entry
+    char digits[20];
+    int i = sizeof(digits);
+    do {
+        digits[--i] = char('0' + number % 10);
+        number /= 10;
+    } while (number);
+    m_buffer.append(digits + i, int(sizeof(digits)) - i);
+}
+
+void
+TreeWriter::writeJsonString(const char *data, int size)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    m_buffer.append('"');
+    const uchar *s = reinterpret_cast<const uchar*>(data);
+    for (int i = 0; i < size;) {
+        const uchar c = s[i];
+        if (c == '"' || c == '\\') {
+            m_buffer.append('\\');
+            m_buffer.append(char(c));
+            ++i;
+            continue;
+        }
+        if (c < 0x20) {
+            const char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            m_buffer.append(escape, sizeof(escape));
+            ++i;
+            continue;
+        }
+        if (c < 0x80) {
+            m_buffer.append(char(c));
+            ++i;
+            continue;
+        }
+
+        if (m_format == Ncdu) {
+            m_buffer.append(char(c));
+            ++i;
+            continue;
+        }
+
+        //copy whole UTF-8 sequences, a stray byte is taken for Latin-1
+        const int length = c >= 0xc2 && c <= 0xdf ? 2 : c >= 0xe0 && c <= 0xef ? 3 : c >= 0xf0 && c <= 0xf4 ? 4 : 0;
+        bool valid = length && i + length <= size;
+        for (int j = 1; valid && j < length; ++j) {
+            valid = (s[i + j] & 0xc0) == 0x80;
+        }
+        if (valid) {
+            m_buffer.append(data + i, length);
+            i += length;
+        } else {
+            const char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            m_buffer.append(escape, sizeof(escape));
+            ++i;
+        }
+    }
+    m_buffer.append('"');
+}
+
+bool
+TreeWriter::flush()
+{
+    if (!m_failed && !m_buffer.isEmpty() && m_device->write(m_buffer) != m_buffer.size()) {
+        m_failed = true;
+    }
+    m_buffer.resize(0); //keeps the capacity reserved
+    return !m_failed;
+}
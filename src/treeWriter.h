@@ -0,0 +1,85 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef TREEWRITER_H
+#define TREEWRITER_H
+
+#include <QByteArray>
+
+class File;
+class Folder;
+class QIODevice;
+
+namespace Filelight
+{
+
+/**
+ * Writes a scan tree out as text, for filelight-scan, Export Listing and
+ * scripts.
+ *
+ * The tree is walked depth first without recursion and written through a
+ * buffer of a megabyte, so the output streams at the speed of the device
+ * and takes no memory beyond the path being written.
+ */
+class TreeWriter
+{
+public:
+    enum Format {
+        /// One JSON object per line and entry, folders before their contents.
+        /// Name bytes that are not UTF-8 are escaped as if they were Latin-1.
+        JsonLines,
+        /// Like du -a -B1, size and path separated by a tab, folders after
+        /// their contents. Sizes are those File::size() picks.
+        Du,
+        /// The JSON export of ncdu, for ncdu -f and the tools that read it.
+        /// Names are written as the bytes they are, like ncdu does, and
+        /// folders without sizes of their own. Estimated folders are marked
+        /// as read errors and carry their estimate.
+        Ncdu
+    };
+
+    TreeWriter(QIODevice *device, Format format);
+
+    /// Ends lines with NUL instead of newline, as du -0 does.
+    void setNullTerminated(bool null) {
+        m_terminator = null ? '\0' : '\n';
+    }
+
+    /// Writes @p tree and everything below it, named by its full path.
+    /// @return false if the device failed
+    bool write(const Folder *tree);
+
+private:
+    void writeEntry(const QByteArray &path, const File *file);
+    void writeNcduEntry(const char *name, int size, const File *file);
+    void writeNumber(quint64 number);
+    void writeJsonString(const char *data, int size);
+    bool flush();
+
+    QIODevice *m_device;
+    const Format m_format;
+    char m_terminator;
+    QByteArray m_buffer;
+    bool m_failed;
+};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#include "uringStat.h"
+
+#include "filelight_debug.h"
+
+#include <linux/io_uring.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Filelight
+{
+
+static int
+uringSetup(uint entries, io_uring_params *params)
+{
+    return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int
+uringEnter(int fd, uint submit, uint complete, uint flags)
+{
+    return int(syscall(__NR_io_uring_enter, fd, submit, complete, flags, nullptr, 0));
+}
+
+static bool
+supportsStatx(int fd)
+{
+    //IORING_OP_STATX arrived in 5.6, the probe interface with it
+    const size_t size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    QByteArray buffer(int(size), '\0');
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0) {
+        return false;
+    }
+    return probe->last_op >= IORING_OP_STATX && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+}
+
+UringStat*
+UringStat::create(uint entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    const int fd = uringSetup(entries, &params);
+    if (fd < 0) {
+        qCDebug(FILELIGHT_LOG) << "io_uring is not available:" << strerror(errno);
+        return nullptr;
+    }
+
+    if (!supportsStatx(fd)) {
+        qCDebug(FILELIGHT_LOG) << "io_uring does not support statx";
+        close(fd);
+        return nullptr;
+    }
+
+    UringStat *ring = new UringStat(fd, params.sq_entries);
+    if (!ring->map(params)) {
+        qCDebug(FILELIGHT_LOG) << "Failed to map the io_uring rings:" << strerror(errno);
+        delete ring;
+        return nullptr;
+    }
+    return ring;
+}
+
+UringStat::UringStat(int fd, uint entries)
+        : m_fd(fd)
+        , m_capacity(int(entries))
+        , m_sqRing(MAP_FAILED)
+        , m_cqRing(MAP_FAILED)
+        , m_sqRingSize(0)
+        , m_cqRingSize(0)
+        , m_sqes(nullptr)
+        , m_sqesSize(0)
+{
+    //names are at most NAME_MAX, the buffer never has to grow mid batch
+    m_names.reserve(m_capacity * 256);
+    m_dirfds.reserve(m_capacity);
+    m_offsets.reserve(m_capacity);
+    m_results.resize(m_capacity);
+    m_stats.resize(m_capacity);
+}
+
+UringStat::~UringStat()
+{
+    if (m_sqes) {
+        munmap(m_sqes, m_sqesSize);
+    }
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    if (m_sqRing != MAP_FAILED) {
+        munmap(m_sqRing, m_sqRingSize);
+    }
+    close(m_fd);
+}
+
+bool
+UringStat::map(const io_uring_params &params)
+{
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap) {
+        m_sqRingSize = m_cqRingSize = qMax(m_sqRingSize, m_cqRingSize);
+    }
+
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        return false;
+    }
+
+    m_cqRing = singleMap ? m_sqRing
+                         : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+    if (m_cqRing == MAP_FAILED) {
+        return false;
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char *sq = static_cast<char*>(m_sqRing);
+    m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+void
+UringStat::add(int dirfd, const char *name)
+{
+    Q_ASSERT(!isFull());
+
+    m_dirfds.append(dirfd);
+    m_offsets.append(m_names.size());
+    m_names.append(name, int(strlen(name)) + 1);
+}
+
+void
+UringStat::clear()
+{
+    m_dirfds.clear();
+    m_offsets.clear();
+    m_names.resize(0); //clear() would free the buffer reserved up front
+}
+
+bool
+UringStat::run(uint mask, int flags)
+{
+    const int count = this->count();
+
+    //the kernel only reads the tail we publish, so write all entries first
+    unsigned tail = *m_sqTail;
+    for (int i = 0; i < count; ++i) {
+        const unsigned index = tail & *m_sqMask;
+        io_uring_sqe *sqe = &m_sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = m_dirfds[i];
+        sqe->addr = reinterpret_cast<quint64>(name(i));
+        sqe->len = mask;
+        sqe->off = reinterpret_cast<quint64>(&m_stats[i]);
+        sqe->statx_flags = flags;
+        sqe->user_data = quint64(i);
+        m_sqArray[index] = index;
+        ++tail;
+    }
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+    int submitted = 0;
+    int completed = 0;
+    bool failed = false;
+    while (completed < (failed ? submitted : count)) {
+        const int ret = uringEnter(m_fd, failed ? 0 : uint(count - submitted), 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            if (failed) {
+                //the requests may still write to the buffers, which are
+                //hence left to them for good
+                qCWarning(FILELIGHT_LOG) << "io_uring_enter failed while draining:" << strerror(errno);
+                new QVector<struct statx>(m_stats);
+                new QByteArray(m_names);
+                break;
+            }
+            //what was submitted still reads the names and writes the stats,
+            //it is waited for before the buffers are reused
+            qCWarning(FILELIGHT_LOG) << "io_uring_enter failed:" << strerror(errno);
+            failed = true;
+            continue;
+        }
+        if (!failed) {
+            submitted += ret;
+        }
+
+        unsigned head = *m_cqHead;
+        const unsigned cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != cqTail; ++head) {
+            const io_uring_cqe &cqe = m_cqes[head & *m_cqMask];
+            m_results[int(cqe.user_data)] = cqe.res < 0 ? -cqe.res : 0;
+            ++completed;
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    return !failed;
+}
+
+}
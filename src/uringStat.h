@@ -0,0 +1,114 @@
+/***********************************************************************
+* Copyright 2020  The Filelight authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License as
+* published by the Free Software Foundation; either version 2 of
+* the License or (at your option) version 3 or any later version
+* accepted by the membership of KDE e.V. (or its successor approved
+* by the membership of KDE e.V.), which shall act as a proxy
+* defined in Section 14 of version 3 of the license.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+***********************************************************************/
+
+#ifndef URINGSTAT_H
+#define URINGSTAT_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <sys/stat.h>
+
+struct io_uring_params;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace Filelight
+{
+
+/**
+ * Stats a batch of entries with a single io_uring submission.
+ *
+ * Entries are queued with add(), run() submits them all at once and waits
+ * for every completion. This keeps many metadata requests in flight from
+ * one thread, which pays off on high latency storage.
+ *
+ * Uses the raw syscalls, we do not want to depend on liburing for this.
+ */
+class UringStat
+{
+public:
+    /// @return 0 if io_uring or IORING_OP_STATX is not available
+    static UringStat *create(uint entries);
+    ~UringStat();
+
+    int capacity() const {
+        return m_capacity;
+    }
+    int count() const {
+        return m_offsets.size();
+    }
+    bool isFull() const {
+        return count() == m_capacity;
+    }
+
+    /// Queues a statx of @p name relative to @p dirfd, the name is copied.
+    void add(int dirfd, const char *name);
+    /// Submits everything queued and waits for it to complete.
+    /// @return false if the ring failed, what it took on has still completed
+    /// by then but the ring is not to be run again
+    bool run(uint mask, int flags);
+    void clear();
+
+    const char *name(int i) const {
+        return m_names.constData() + m_offsets[i];
+    }
+    /// 0 on success, otherwise the errno of the failed statx
+    int error(int i) const {
+        return m_results[i];
+    }
+    const struct statx &stat(int i) const {
+        return m_stats[i];
+    }
+
+private:
+    UringStat(int fd, uint entries);
+    bool map(const struct io_uring_params &params);
+
+    int m_fd;
+    int m_capacity;
+
+    void *m_sqRing;
+    void *m_cqRing;
+    size_t m_sqRingSize;
+    size_t m_cqRingSize;
+    io_uring_sqe *m_sqes;
+    size_t m_sqesSize;
+
+    unsigned *m_sqTail;
+    unsigned *m_sqMask;
+    unsigned *m_sqArray;
+    unsigned *m_cqHead;
+    unsigned *m_cqTail;
+    unsigned *m_cqMask;
+    io_uring_cqe *m_cqes;
+
+    QVector<int> m_dirfds;
+    QByteArray m_names;
+    QVector<int> m_offsets;
+    QVector<int> m_results;
+    QVector<struct statx> m_stats;
+
+    UringStat(const UringStat&); //undefined
+    void operator=(const UringStat&); //undefined
+};
+}
+
+#endif